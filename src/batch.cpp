@@ -0,0 +1,58 @@
+#include "batch.h"
+
+namespace proto {
+
+ThreadPool::ThreadPool(size_t threads) {
+  for (size_t i = 1; i < threads; ++i) {
+    _workers.emplace_back([this]() {
+      std::unique_lock lock(_mutex);
+      for (size_t seen = 0;;) {
+        _start.wait(lock, [this, seen]() { return _stop || _generation != seen; });
+        if (_stop) {
+          return;
+        }
+        seen = _generation;
+        _work(lock);
+      }
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(_mutex);
+    _stop = true;
+  }
+  _start.notify_all();
+  for (auto& worker : _workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::_run(size_t n, void* func, Task task) {
+  std::lock_guard run_lock(_run_mutex);
+  std::unique_lock lock(_mutex);
+  _func = func;
+  _task = task;
+  _next = 0;
+  _end = n;
+  _pending = n;
+  ++_generation;
+  _start.notify_all();
+  _work(lock);
+  _done.wait(lock, [this]() { return _pending == 0; });
+}
+
+void ThreadPool::_work(std::unique_lock<std::mutex>& lock) {
+  while (_next < _end) {
+    size_t i = _next++;
+    lock.unlock();
+    _task(_func, i);
+    lock.lock();
+    if (--_pending == 0) {
+      _done.notify_all();
+    }
+  }
+}
+
+}  // namespace proto
@@ -0,0 +1,157 @@
+#include "buffer.h"
+
+#include <algorithm>
+
+namespace proto {
+
+void Sink::reset() {
+  _str = &_own;
+  _data = _own.data();
+  _base = 0;
+  _pos = 0;
+  _cap = _own.size();
+  _overflow = false;
+  _chunk = 0;
+  _flushed = 0;
+  _flush = nullptr;
+}
+
+void Sink::release() {
+  std::string().swap(_own);
+  reset();
+}
+
+void Sink::append_to(std::string& out) {
+  _str = &out;
+  _data = out.data();
+  _base = out.size();
+  _pos = out.size();
+  _cap = out.size();
+  _overflow = false;
+  _chunk = 0;
+  _flushed = 0;
+  _flush = nullptr;
+}
+
+void Sink::write_into(std::span<char> out) {
+  _str = nullptr;
+  _data = out.data();
+  _base = 0;
+  _pos = 0;
+  _cap = out.size();
+  _overflow = false;
+  _chunk = 0;
+  _flushed = 0;
+  _flush = nullptr;
+}
+
+void Sink::_flush_to(size_t chunk_size, void* func, bool (*flush)(void*, std::string_view)) {
+  reset();
+  _chunk = std::max<size_t>(chunk_size, 1);
+  _func = func;
+  _flush = flush;
+  if (_own.size() < _chunk) {
+    _own.resize_and_overwrite(_chunk, [](char*, size_t len) { return len; });
+  }
+  _data = _own.data();
+  _cap = _chunk;
+}
+
+void Sink::insert(size_t at, const void* src, size_t n) {
+  // a claim past the end of the chunk would flush the bytes to move
+  if (at < _flushed || (_flush && _cap - _pos < n)) [[unlikely]] {
+    _overflow = true;
+    return;
+  }
+  size_t behind = size() - at;
+  if (!claim(n)) {
+    return;
+  }
+  char* dst = _data + _base + (at - _flushed);
+  std::memmove(dst + n, dst, behind);
+  std::memcpy(dst, src, n);
+}
+
+void Sink::finish() {
+  if (_flush) {
+    _overflow || _flush_pending();
+    return;
+  }
+  if (_str) {
+    _str->resize(_pos);
+    _data = _str->data();
+    _cap = _pos;
+  }
+}
+
+void Sink::rollback() {
+  _pos = _base;
+  _overflow = false;
+  finish();
+}
+
+auto Sink::take() -> std::string {
+  finish();
+  std::string res = _str == &_own ? std::move(_own) : std::string(view());
+  reset();
+  return res;
+}
+
+bool Sink::_grow(size_t n) {
+  if (_flush) {
+    if (_overflow || !_flush_pending()) {
+      return false;
+    }
+    // a claim larger than a chunk takes a buffer of its size, and is flushed by itself at the next write
+    if (_own.size() < n) {
+      _own.resize_and_overwrite(n, [](char*, size_t len) { return len; });
+      _data = _own.data();
+    }
+    _cap = std::max(n, _chunk);
+    return true;
+  }
+  if (!_str) {
+    _overflow = true;
+    return false;
+  }
+  // the target string is resized to the whole capacity, bytes behind `_pos` are trimmed by `finish()`. A string
+  // appended to may have reserved room already, which is used up before growing
+  size_t cap = _pos + n <= _str->capacity() ? _str->capacity() : std::max({_cap * 2, _pos + n, size_t(64)});
+  _str->resize_and_overwrite(cap, [](char*, size_t len) { return len; });
+  _data = _str->data();
+  _cap = cap;
+  return true;
+}
+
+void Sink::_write_slow(const void* src, size_t n) {
+  if (!_flush) {
+    if (_grow(n)) {
+      std::memcpy(_data + _pos, src, n);
+      _pos += n;
+    }
+    return;
+  }
+  // split at the chunk ends
+  for (auto* p = static_cast<const char*>(src); n > 0;) {
+    if (_pos == _cap && !_grow(1)) {
+      return;
+    }
+    size_t m = std::min(n, _cap - _pos);
+    std::memcpy(_data + _pos, p, m);
+    _pos += m;
+    p += m;
+    n -= m;
+  }
+}
+
+bool Sink::_flush_pending() {
+  if (_pos > 0 && !_flush(_func, {_data, _pos})) {
+    _overflow = true;
+    return false;
+  }
+  _flushed += _pos;
+  _pos = 0;
+  return true;
+}
+
+}  // namespace proto
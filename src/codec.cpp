@@ -4,144 +4,296 @@
 
 namespace proto::_impl {
 
-auto TextCodec::encode(const std::string& str) -> std::expected<void, Error> {
-  _ss << '"' << str << '"';
-  return {};
+Error& Error::at(std::string_view field) {
+  path.insert(0, path.empty() || path.front() == '[' ? "" : ".").insert(0, field);
+  return *this;
 }
 
-auto TextCodec::decode(std::string& str) -> std::expected<void, Error> {
-  try {
-    _try_eat('"', "string start");
-    std::stringstream buffer;
-    while (!_see('"')) {
-      char c;
-      _get(c);
-      buffer << c;
-    }
-    _try_eat('"', "string end");
-    str = buffer.str();
-  } catch (Error e) {
-    return std::unexpected(std::move(e));
+Error& Error::at(size_t index) {
+  path.insert(0, std::format("[{}]{}", index, path.empty() || path.front() == '[' ? "" : "."));
+  return *this;
+}
+
+namespace {
+
+// escape sequence of a character `simd::find_escape` stops at
+std::string_view escape(char c, char (&buffer)[6]) {
+  switch (c) {
+    case '"':
+      return "\\\"";
+    case '\\':
+      return "\\\\";
+    case '\b':
+      return "\\b";
+    case '\f':
+      return "\\f";
+    case '\n':
+      return "\\n";
+    case '\r':
+      return "\\r";
+    case '\t':
+      return "\\t";
   }
-  return {};
+  constexpr char digits[] = "0123456789abcdef";
+  std::memcpy(buffer, "\\u00", 4);
+  buffer[4] = digits[static_cast<unsigned char>(c) >> 4];
+  buffer[5] = digits[c & 0xf];
+  return {buffer, 6};
 }
 
-auto TextCodec::encode(bool b) -> std::expected<void, Error> {
-  _ss << (b ? "true" : "false");
+// append the utf-8 encoding of a code point
+void append_utf8(std::string& out, uint32_t code) {
+  if (code < 0x80) {
+    out += static_cast<char>(code);
+  } else if (code < 0x800) {
+    out += static_cast<char>(0xc0 | code >> 6);
+    out += static_cast<char>(0x80 | (code & 0x3f));
+  } else if (code < 0x10000) {
+    out += static_cast<char>(0xe0 | code >> 12);
+    out += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+    out += static_cast<char>(0x80 | (code & 0x3f));
+  } else {
+    out += static_cast<char>(0xf0 | code >> 18);
+    out += static_cast<char>(0x80 | (code >> 12 & 0x3f));
+    out += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+    out += static_cast<char>(0x80 | (code & 0x3f));
+  }
+}
+
+// parse the 4 hex digits of a `\u` escape
+bool parse_hex4(const char* p, const char* end, uint32_t& code) {
+  if (end - p < 4) {
+    return false;
+  }
+  auto r = std::from_chars(p, p + 4, code, 16);
+  return r.ec == std::errc() && r.ptr == p + 4;
+}
+
+}  // namespace
+
+size_t TextCodec::size_of(std::string_view str) {
+  size_t size = str.size() + 2;
+  char buffer[6];
+  for (size_t n; (n = simd::find_escape(str.data(), str.size())) < str.size(); str.remove_prefix(n + 1)) {
+    size += escape(str[n], buffer).size() - 1;
+  }
+  return size;
+}
+
+auto TextCodec::encode(std::string_view str) -> std::expected<void, Error> {
+  _sink.put('"');
+  // runs without special characters are copied at once
+  char buffer[6];
+  for (size_t n; (n = simd::find_escape(str.data(), str.size())) < str.size(); str.remove_prefix(n + 1)) {
+    _sink.write(str.data(), n);
+    _sink.write(escape(str[n], buffer));
+  }
+  _sink.write(str);
+  _sink.put('"');
   return {};
 }
 
-auto TextCodec::decode(bool& b) -> std::expected<void, Error> {
-  _drop_blanks();
-  if (_see('0')) {
-    _try_eat('0', "");
-    b = false;
-    return {};
+auto TextCodec::_decode_string() -> std::expected<std::string_view, Error> {
+  if (auto r = _eat('"'); !r) {
+    return std::unexpected(std::move(r.error()));
   }
-  if (_see('1')) {
-    _try_eat('1', "");
-    b = true;
-    return {};
+  const char* p = _source.cursor();
+  const char* end = _source.end();
+  size_t n = simd::find_quote(p, end - p);
+  if (p + n < end && p[n] == '"') {
+    // no escape, the common case is viewed in place
+    _source.seek(p + n + 1);
+    return std::string_view(p, n);
   }
-  if (_see('t') || _see('T')) {
-    char buffer[4] = {0};
-    _ss.read(buffer, 4);
-    if (std::strcmp(buffer, "true") || std::strcmp(buffer, "True") || std::strcmp(buffer, "TRUE")) {
-      b = true;
-      return {};
+  _scratch.clear();
+  for (;; n = simd::find_quote(p, end - p)) {
+    _scratch.append(p, n);
+    p += n;
+    if (p < end && *p == '"') {
+      _source.seek(p + 1);
+      return std::string_view(_scratch);
     }
-  }
-  if (_see('f') || _see('F')) {
-    char buffer[5] = {0};
-    _ss.read(buffer, 5);
-    if (std::strcmp(buffer, "false") || std::strcmp(buffer, "False") || std::strcmp(buffer, "FALSE")) {
-      b = false;
-      return {};
+    if (end - p < 2) {
+      // neither a closing quote nor an escaped character follows
+      return std::unexpected(Error("string end: expect char '\"'"));
+    }
+    p += 2;
+    switch (char c = p[-1]; c) {
+      case '"':
+      case '\\':
+      case '/':
+        _scratch += c;
+        break;
+      case 'b':
+        _scratch += '\b';
+        break;
+      case 'f':
+        _scratch += '\f';
+        break;
+      case 'n':
+        _scratch += '\n';
+        break;
+      case 'r':
+        _scratch += '\r';
+        break;
+      case 't':
+        _scratch += '\t';
+        break;
+      case 'u': {
+        uint32_t code, low;
+        if (!parse_hex4(p, end, code)) {
+          return std::unexpected(Error("string parse: invalid unicode escape"));
+        }
+        p += 4;
+        // a surrogate pair takes two escapes
+        if (code >= 0xd800 && code < 0xdc00 && end - p >= 2 && p[0] == '\\' && p[1] == 'u' &&
+            parse_hex4(p + 2, end, low) && low >= 0xdc00 && low < 0xe000) {
+          code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+          p += 6;
+        } else if (code >= 0xd800 && code < 0xe000) {
+          // a lone surrogate has no utf-8 form
+          return std::unexpected(Error("string parse: invalid unicode escape"));
+        }
+        append_utf8(_scratch, code);
+        break;
+      }
+      default:
+        return std::unexpected(Error(std::format("string parse: invalid escape '\\{}'", c)));
     }
   }
-  return std::unexpected(Error("invalid bytes for bool"));
 }
 
-bool TextCodec::_see(char c) {
-  _drop_blanks();
-  return _ss.peek() == c;
+auto TextCodec::_skip_value() -> std::expected<void, Error> {
+  // bit stack of the open brackets, set for objects
+  uint64_t objects = 0;
+  size_t depth = 0;
+  do {
+    _drop_blanks();
+    switch (int c = _source.peek(); c) {
+      case '"':
+        if (auto r = _decode_string(); !r) {
+          return std::unexpected(std::move(r.error()));
+        }
+        break;
+      case '{':
+      case '[':
+        if (depth == 64) {
+          return std::unexpected(Error("skipped value nests too deep"));
+        }
+        objects = objects << 1 | (c == '{');
+        ++depth;
+        _source.skip();
+        break;
+      case '}':
+      case ']':
+        if (depth == 0 || (objects & 1) != (c == '}')) {
+          return std::unexpected(Error(std::format("unexpected char '{}'", char(c))));
+        }
+        objects >>= 1;
+        --depth;
+        _source.skip();
+        break;
+      case ',':
+      case ':':
+        if (depth == 0) {
+          return std::unexpected(Error(std::format("unexpected char '{}'", char(c))));
+        }
+        _source.skip();
+        break;
+      case Source::eof:
+        return std::unexpected(Error("unexpected end of value"));
+      default:
+        // a number or a literal runs until a blank or a structural character
+        for (std::string_view ends = "{}[]:,\""; !_is_blank(c) && c != Source::eof; c = _source.peek()) {
+          if (ends.find(static_cast<char>(c)) != std::string_view::npos) {
+            break;
+          }
+          _source.skip();
+        }
+    }
+  } while (depth > 0);
+  return {};
 }
 
-auto TextCodec::_catch(std::function<void()>&& func) -> std::expected<void, Error> {
-  try {
-    func();
-  } catch (Error e) {
-    return std::unexpected(std::move(e));
-  }
+auto TextCodec::encode(bool b) -> std::expected<void, Error> {
+  _sink.write(b ? "true" : "false");
   return {};
 }
 
-void TextCodec::_try(std::expected<void, Error>&& ex, std::string&& msg) {
-  if (!ex) {
-    throw Error(msg + ": " + std::move(ex.error().err_msg));
+auto TextCodec::decode(bool& b) -> std::expected<void, Error> {
+  _drop_blanks();
+  if (_see('0') || _see('1')) {
+    b = _source.get() == '1';
+    return {};
   }
+  for (std::string_view word : {"true", "True", "TRUE", "false", "False", "FALSE"}) {
+    if (std::string_view(_source.cursor(), _source.end()).starts_with(word)) {
+      _source.skip(word.size());
+      b = word.size() == 4;
+      return {};
+    }
+  }
+  return std::unexpected(Error("invalid bytes for bool"));
 }
 
-void TextCodec::_try_eat(char c, std::string&& msg) {
-  _drop_blanks();
-  if (_ss.peek() != c) {
-    throw Error(std::format("expect char '{}'", c));
+void TextCodec::_skip_blanks() {
+  if (_tokenize) {
+    // only characters starting tokens may follow blanks, so a blank run ends at the next token
+    while (!_source.seek_token() && _is_blank(_source.peek())) {
+      _index_tokens();
+    }
+    return;
+  }
+  for (int c = _source.peek(); _is_blank(c); c = _source.peek()) {
+    _source.skip();
   }
-  _ss >> c;
 }
 
-void TextCodec::_drop_blanks() {
-  while (!_ss.eof()) {
-    char c = _ss.peek();
-    if (c != ' ' && c != '\n' && c != '\t') {
-      return;
-    }
-    _ss.get();
+void TextCodec::_index_tokens() {
+  // a window following the last one grows, the cursor is outside strings either way and a fresh scan starts there
+  _window = _source.cursor() == _window_end ? std::min(_window * 2, _max_window) : _min_window;
+  size_t n = std::min(_window, _source.remaining());
+  if (_tokens_capacity < n) {
+    _tokens = std::make_unique_for_overwrite<uint32_t[]>(_window);
+    _tokens_capacity = _window;
   }
+  _window_end = _source.cursor() + n;
+  size_t count = simd::json_tokens(_source.cursor(), n, _tokens.get());
+  _source.index(n, {_tokens.get(), count});
 }
 
-auto BytesCodec::encode(const std::string& value) -> std::expected<void, Error> {
+template <std::endian Order>
+auto BytesCodec<Order>::encode(std::string_view value) -> std::expected<void, Error> {
   auto len = _encode_varible_len(value.size());
   if (!len) {
     return std::unexpected(len.error());
   }
-  _ss.write(value.data(), *len);
+  _sink.write(value.data(), *len);
   return {};
 }
 
-auto BytesCodec::decode(std::string& value) -> std::expected<void, Error> {
-  char c;
-  if (_ss.read(&c, 1); c != _variable_length_tag) {
+template <std::endian Order>
+auto BytesCodec<Order>::_decode_string() -> std::expected<std::string_view, Error> {
+  if (_source.get() != static_cast<unsigned char>(_variable_length_tag)) {
     return std::unexpected(Error("string start: expect variable length tag"));
   }
   VariableLength len;
   if (auto r = decode(len); !r) {
-    return r;
+    return std::unexpected(std::move(r.error()));
   }
-  value.resize(len);
-  _ss.read(value.data(), len);
-  if (_ss.gcount() != len) {
+  const char* bytes = _source.take(len);
+  if (!bytes) {
     return std::unexpected(Error("string parse: insufficent bytes for string"));
   }
-  return {};
+  return std::string_view(bytes, len);
 }
 
-auto BytesCodec::_catch(std::function<void()>&& func) -> std::expected<void, Error> {
-  try {
-    func();
-  } catch (Error e) {
-    return std::unexpected(std::move(e));
-  }
-  return {};
-}
-
-auto BytesCodec::_decode_variable_len() -> std::expected<VariableLength, Error> {
-  if (_ss.eof()) {
+template <std::endian Order>
+auto BytesCodec<Order>::_decode_variable_len() -> std::expected<VariableLength, Error> {
+  if (_source.empty()) {
     return std::unexpected(Error("no sufficient bytes"));
   }
-  char c;
-  _ss >> c;
-  if (c != _variable_length_tag) {
+  if (_source.get() != static_cast<unsigned char>(_variable_length_tag)) {
     return std::unexpected(Error("expect variable length tag"));
   }
   VariableLength len;
@@ -151,13 +303,29 @@ auto BytesCodec::_decode_variable_len() -> std::expected<VariableLength, Error>
   return len;
 }
 
-void BytesCodec::_reverse_byte_order(char* start, size_t size) {
-  char* end = start + size - 1;
-  while (start < end) {
-    std::swap(*start, *end);
-    ++start;
-    --end;
+template class BytesCodec<std::endian::big>;
+template class BytesCodec<std::endian::little>;
+
+}  // namespace proto::_impl
+
+namespace proto {
+
+auto CompactBinaryCodec::encode(std::string_view value) -> std::expected<void, Error> {
+  _put_varint(value.size());
+  _sink.write(value);
+  return {};
+}
+
+auto CompactBinaryCodec::_decode_string() -> std::expected<std::string_view, Error> {
+  uint64_t len;
+  if (!_get_varint(len)) {
+    return std::unexpected(Error("string start: invalid length"));
   }
+  const char* bytes = len <= _source.remaining() ? _source.take(len) : nullptr;
+  if (!bytes) {
+    return std::unexpected(Error("string parse: insufficent bytes for string"));
+  }
+  return std::string_view(bytes, len);
 }
 
-}  // namespace proto::_impl
+}  // namespace proto
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "proto.h"
+
+namespace proto {
+
+/**
+ * @brief A fixed set of worker threads which run parallel loops, one at a time
+ */
+class ThreadPool {
+ public:
+  /**
+   * @param threads Threads taking part in a loop, the calling thread included
+   */
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+
+  ThreadPool(const ThreadPool&) = delete;
+
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool();
+
+  size_t size() const { return _workers.size() + 1; }
+
+  /**
+   * @brief Call `func(i)` for each `i` in [0, n) on the workers and the calling thread, and return once all are done
+   */
+  template <typename Func>
+  void run(size_t n, Func&& func) {
+    _run(n, &func, [](void* f, size_t i) { (*static_cast<std::remove_reference_t<Func>*>(f))(i); });
+  }
+
+ private:
+  using Task = void (*)(void*, size_t);
+
+  std::vector<std::thread> _workers;
+  std::mutex _run_mutex;  // one loop at a time
+  std::mutex _mutex;
+  std::condition_variable _start;
+  std::condition_variable _done;
+  // the running loop, taken by index under `_mutex`
+  void* _func = nullptr;
+  Task _task = nullptr;
+  size_t _next = 0;
+  size_t _end = 0;
+  size_t _pending = 0;
+  size_t _generation = 0;
+  bool _stop = false;
+
+  void _run(size_t n, void* func, Task task);
+
+  // take and call loop indexes till there is none left
+  void _work(std::unique_lock<std::mutex>& lock);
+};
+
+/**
+ * @brief Models encoded back to back into one buffer
+ */
+struct Batch {
+  std::string data;
+  // `size() + 1` ascending offsets into `data`, the i-th model takes [offsets[i], offsets[i + 1])
+  std::vector<size_t> offsets = {0};
+
+  size_t size() const { return offsets.size() - 1; }
+
+  std::string_view operator[](size_t i) const {
+    return std::string_view(data).substr(offsets[i], offsets[i + 1] - offsets[i]);
+  }
+};
+
+namespace _impl {
+
+// split `n` items into chunks, a few per thread for balance, and call `func(begin, end)` on each
+template <typename Func>
+void for_chunks(size_t n, ThreadPool* pool, Func&& func) {
+  size_t chunks = pool && n > 1 ? std::min(n, pool->size() * 4) : 1;
+  auto chunk = [n, chunks, &func](size_t i) { func(n * i / chunks, n * (i + 1) / chunks); };
+  pool && chunks > 1 ? pool->run(chunks, chunk) : chunk(0);
+}
+
+}  // namespace _impl
+
+/**
+ * @brief Encode each model of `models` back to back into one buffer
+ *
+ * @param pool If given, contiguous chunks of models are encoded in parallel with a codec each, and joined at last
+ * @return The encoded models and their offsets, or the error of the first model failed, e.g. at path `[42].name`
+ */
+template <Codeable Codec, std::ranges::contiguous_range Models>
+auto encode_batch(const Models& models, ThreadPool* pool = nullptr) -> std::expected<Batch, typename Codec::Error> {
+  std::span items(std::ranges::data(models), std::ranges::size(models));
+  struct Chunk {
+    size_t begin = 0;
+    std::string data = {};
+    std::vector<size_t> ends = {};  // offsets in `data` the models end at
+    std::expected<void, typename Codec::Error> res = {};
+  };
+  std::vector<Chunk> chunks;
+  std::mutex mutex;
+  _impl::for_chunks(items.size(), pool, [&items, &chunks, &mutex](size_t begin, size_t end) {
+    Chunk chunk = {.begin = begin};
+    size_t size = 0;
+    for (size_t i = begin; i < end; ++i) {
+      size += items[i].template encoded_size<Codec>();
+    }
+    // reserved once for the chunk, the models are appended without sizing each again
+    chunk.data.reserve(size);
+    chunk.ends.reserve(end - begin);
+    _impl::PooledSession<Codec> session;
+    for (size_t i = begin; i < end && chunk.res; ++i) {
+      if (auto r = items[i].encode_by(chunk.data, *session); r) {
+        chunk.ends.push_back(chunk.data.size());
+      } else {
+        chunk.res = std::unexpected(std::move(r.error().at(i)));
+      }
+    }
+    std::lock_guard lock(mutex);
+    chunks.push_back(std::move(chunk));
+  });
+  std::ranges::sort(chunks, {}, &Chunk::begin);
+
+  Batch batch;
+  if (chunks.size() == 1 && chunks[0].res) {
+    // no copy for a single chunk
+    batch.data = std::move(chunks[0].data);
+    batch.offsets.insert(batch.offsets.end(), chunks[0].ends.begin(), chunks[0].ends.end());
+    return batch;
+  }
+  size_t size = 0;
+  for (auto& chunk : chunks) {
+    if (!chunk.res) {
+      return std::unexpected(std::move(chunk.res.error()));
+    }
+    size += chunk.data.size();
+  }
+  batch.data.reserve(size);
+  batch.offsets.reserve(items.size() + 1);
+  for (auto& chunk : chunks) {
+    size_t base = batch.data.size();
+    batch.data += chunk.data;
+    for (size_t end : chunk.ends) {
+      batch.offsets.push_back(base + end);
+    }
+  }
+  return batch;
+}
+
+/**
+ * @brief Decode the models of a batch, each model is decoded in place from its own bytes
+ *
+ * @param offsets `n + 1` ascending offsets into `data` of `n` models, as `Batch::offsets`
+ * @param pool If given, contiguous chunks of models are decoded in parallel
+ * @return The decoded models, or the error of the first model failed, bytes left behind a model included
+ */
+template <Codeable Codec, typename Model>
+auto decode_batch(std::string_view data, std::span<const size_t> offsets, ThreadPool* pool = nullptr)
+    -> std::expected<std::vector<Model>, typename Codec::Error> {
+  size_t n = offsets.empty() ? 0 : offsets.size() - 1;
+  if (n > 0 && (offsets.back() > data.size() || !std::ranges::is_sorted(offsets))) {
+    return std::unexpected(typename Codec::Error("invalid batch offsets"));
+  }
+  std::vector<Model> models(n);
+  // the first failed model of each chunk
+  std::vector<std::pair<size_t, typename Codec::Error>> errors;
+  std::mutex mutex;
+  _impl::for_chunks(n, pool, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      auto bytes = data.substr(offsets[i], offsets[i + 1] - offsets[i]);
+      auto r = Model::template decode_into<Codec>(models[i], bytes);
+      if (r && *r != bytes.size()) {
+        r = std::unexpected(typename Codec::Error(std::format("{} trailing bytes", bytes.size() - *r)));
+      }
+      if (!r) {
+        std::lock_guard lock(mutex);
+        errors.emplace_back(i, std::move(r.error().at(i)));
+        return;
+      }
+    }
+  });
+  if (!errors.empty()) {
+    auto first = std::ranges::min_element(errors, {}, [](auto& e) { return e.first; });
+    return std::unexpected(std::move(first->second));
+  }
+  return models;
+}
+
+template <Codeable Codec, typename Model>
+auto decode_batch(const Batch& batch, ThreadPool* pool = nullptr)
+    -> std::expected<std::vector<Model>, typename Codec::Error> {
+  return decode_batch<Codec, Model>(batch.data, batch.offsets, pool);
+}
+
+}  // namespace proto
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace proto {
+
+/**
+ * @brief A contiguous output byte sink which codecs write into directly
+ *
+ * @note Works in one of four modes:
+ *  - owned: a growable buffer held by the sink, extracted by `take()` without copy
+ *  - append: bytes are appended to a caller `std::string`, whose existing content is kept
+ *  - fixed: bytes are written into a caller `std::span<char>`, which never grows and reports `overflow()` instead
+ *  - chunked: bytes are written into the owned buffer, which is handed to a callback and emptied each time it is full.
+ *    Offsets passed to `patch()` and `insert()` still count from the first byte written, but must not reach a flushed
+ *    one, the sink overflows instead
+ */
+class Sink {
+ public:
+  Sink() = default;
+
+  explicit Sink(std::string& out) { append_to(out); }
+
+  explicit Sink(std::span<char> out) { write_into(out); }
+
+  Sink(const Sink&) = delete;
+
+  Sink& operator=(const Sink&) = delete;
+
+  /**
+   * @brief Discard written bytes and go back to owned mode, the owned buffer capacity is kept
+   */
+  void reset();
+
+  /**
+   * @brief Append following writes to `out`, a `finish()` is required before `out` is read
+   */
+  void append_to(std::string& out);
+
+  /**
+   * @brief Write following writes into `out`, bytes beyond its size are dropped and mark `overflow()`
+   */
+  void write_into(std::span<char> out);
+
+  /**
+   * @brief Write following writes into the owned buffer, which is passed to `flush` and emptied as soon as the next
+   * write would take it past `chunk_size` bytes, and at `finish()`. A single claim larger than that is flushed by
+   * itself, writes are split. `flush` returns false to stop, which drops further writes and marks `overflow()`
+   *
+   * @note `flush` must outlive the writes. Flushed bytes are gone, a `patch()` or `insert()` reaching them, or an
+   * `insert()` which does not fit the rest of the chunk, marks `overflow()`
+   */
+  template <typename Func>
+  void flush_to(size_t chunk_size, Func& flush) {
+    _flush_to(chunk_size, &flush, [](void* func, std::string_view chunk) -> bool {
+      return (*static_cast<Func*>(func))(chunk);
+    });
+  }
+
+  void put(char c) {
+    if (_pos == _cap && !_grow(1)) [[unlikely]] {
+      return;
+    }
+    _data[_pos++] = c;
+  }
+
+  void write(const void* src, size_t n) {
+    if (_cap - _pos < n) [[unlikely]] {
+      return _write_slow(src, n);
+    }
+    std::memcpy(_data + _pos, src, n);
+    _pos += n;
+  }
+
+  void write(std::string_view sv) { write(sv.data(), sv.size()); }
+
+  /**
+   * @brief Claim `n` writable bytes at the end of the sink
+   *
+   * @return Start of the claimed bytes, or nullptr if the sink overflows
+   */
+  char* claim(size_t n) {
+    if (_cap - _pos < n && !_grow(n)) [[unlikely]] {
+      return nullptr;
+    }
+    return _data + (_pos += n) - n;
+  }
+
+  /**
+   * @brief Give back the last `n` claimed but unused bytes
+   */
+  void unclaim(size_t n) { _pos -= n; }
+
+  /**
+   * @brief Overwrite `n` bytes at offset `at` of the written bytes, e.g. a length prefix which is known only after
+   * the content it covers is written. Bytes dropped by an overflow are not patched, flushed ones overflow the sink
+   */
+  void patch(size_t at, const void* src, size_t n) {
+    if (at < _flushed) [[unlikely]] {
+      _overflow = true;
+      return;
+    }
+    if (at + n <= size()) {
+      std::memcpy(_data + _base + (at - _flushed), src, n);
+    }
+  }
+
+  /**
+   * @brief Insert `n` bytes at offset `at` of the written bytes, the ones behind are moved back, e.g. a variable
+   * length prefix which is known only after the content it covers is written. Flushed bytes overflow the sink
+   */
+  void insert(size_t at, const void* src, size_t n);
+
+  /**
+   * @brief Make sure `n` more bytes can be written without reallocation
+   */
+  void reserve(size_t n) { _cap - _pos < n ? void(_grow(n)) : void(); }
+
+  /**
+   * @brief Bytes written by this sink, flushed ones included, the existing content of an appended string is excluded
+   */
+  size_t size() const { return _flushed + _pos - _base; }
+
+  /**
+   * @brief Chunk size of the chunked mode, 0 in other modes
+   */
+  size_t chunk_size() const { return _chunk; }
+
+  bool overflow() const { return _overflow; }
+
+  /**
+   * @brief Capacity of the owned buffer, which `reset()` keeps
+   */
+  size_t capacity() const { return _own.capacity(); }
+
+  /**
+   * @brief Free the owned buffer and go back to owned mode
+   */
+  void release();
+
+  /**
+   * @brief Bytes written and not flushed
+   */
+  std::string_view view() const { return {_data + _base, _pos - _base}; }
+
+  /**
+   * @brief Trim the target string to the written bytes, no-op in fixed mode. Flush the rest in chunked mode
+   */
+  void finish();
+
+  /**
+   * @brief Drop everything written by this sink, an appended string is restored to its original size
+   */
+  void rollback();
+
+  /**
+   * @brief Move the written bytes out of an owned sink, the sink is reset to empty
+   */
+  auto take() -> std::string;
+
+ private:
+  std::string _own;
+  std::string* _str = &_own;  // nullptr in fixed mode
+  char* _data = nullptr;
+  size_t _base = 0;
+  size_t _pos = 0;
+  size_t _cap = 0;
+  bool _overflow = false;
+  // chunked mode
+  size_t _chunk = 0;
+  size_t _flushed = 0;
+  void* _func = nullptr;
+  bool (*_flush)(void*, std::string_view) = nullptr;
+
+  bool _grow(size_t n);
+
+  void _write_slow(const void* src, size_t n);
+
+  void _flush_to(size_t chunk_size, void* func, bool (*flush)(void*, std::string_view));
+
+  // hand the unflushed bytes to the callback, false if it stops
+  bool _flush_pending();
+};
+
+/**
+ * @brief A non-owning input cursor which codecs decode from directly
+ *
+ * @note The viewed bytes must outlive the source
+ */
+class Source {
+ public:
+  inline static constexpr int eof = -1;
+
+  Source() = default;
+
+  explicit Source(std::string_view data) { reset(data); }
+
+  void reset(std::string_view data) {
+    _begin = _cur = data.data();
+    _end = data.data() + data.size();
+    _window = _window_end = nullptr;
+    _tokens = {};
+  }
+
+  bool empty() const { return _cur == _end; }
+
+  size_t remaining() const { return _end - _cur; }
+
+  /**
+   * @brief Bytes consumed since the last `reset()`
+   */
+  size_t consumed() const { return _cur - _begin; }
+
+  const char* cursor() const { return _cur; }
+
+  const char* end() const { return _end; }
+
+  /**
+   * @brief Move the cursor to `pos`, which must lie between the current cursor and `end()`
+   */
+  void seek(const char* pos) { _cur = pos; }
+
+  /**
+   * @brief Move the cursor back to `pos`, which must lie between the start and the current cursor. The token index is
+   * dropped
+   */
+  void rewind(const char* pos) {
+    _cur = pos;
+    _window = _window_end = nullptr;
+    _tokens = {};
+  }
+
+  /**
+   * @return Next byte without consuming it, or `eof`
+   */
+  int peek() const { return _cur < _end ? static_cast<unsigned char>(*_cur) : eof; }
+
+  /**
+   * @return Next byte, or `eof`
+   */
+  int get() { return _cur < _end ? static_cast<unsigned char>(*_cur++) : eof; }
+
+  void skip(size_t n = 1) { _cur += n; }
+
+  /**
+   * @brief Consume `n` bytes
+   *
+   * @return Start of the consumed bytes, or nullptr (and nothing is consumed) if there are not enough bytes
+   */
+  const char* take(size_t n) {
+    if (remaining() < n) [[unlikely]] {
+      return nullptr;
+    }
+    return (_cur += n) - n;
+  }
+
+  /**
+   * @brief Attach the ascending offsets, relative to the cursor, of the token starts in the next `n` bytes. `tokens`
+   * must outlive the source or the next `index()` and `reset()`
+   */
+  void index(size_t n, std::span<const uint32_t> tokens) {
+    _window = _cur;
+    _window_end = _cur + n;
+    _tokens = tokens;
+    _token = 0;
+  }
+
+  /**
+   * @brief Move the cursor to the first indexed token start at or after it, which must not be inside a token
+   *
+   * @return false if the cursor is not indexed, or there is no token left in the indexed bytes. In the latter case
+   * the cursor moves to the end of them
+   */
+  bool seek_token() {
+    if (_cur < _window || _cur >= _window_end) {
+      return false;
+    }
+    while (_token < _tokens.size() && _window + _tokens[_token] < _cur) {
+      ++_token;
+    }
+    _cur = _token < _tokens.size() ? _window + _tokens[_token] : _window_end;
+    return _token < _tokens.size();
+  }
+
+ private:
+  const char* _begin = nullptr;
+  const char* _cur = nullptr;
+  const char* _end = nullptr;
+  // token index of bytes [_window, _window_end)
+  const char* _window = nullptr;
+  const char* _window_end = nullptr;
+  std::span<const uint32_t> _tokens;
+  size_t _token = 0;
+};
+
+}  // namespace proto
@@ -1,43 +1,345 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
 #include <cstdint>
 #include <expected>
 #include <format>
-#include <functional>
-#include <sstream>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "simd.h"
 
 namespace proto {
 
 template <typename Derived>
 class BaseModel;
 
+/**
+ * @brief A codec encodes into its `sink()` and decodes from its `source()`, and tells the encoded size of a value by
+ * `size_of()` without encoding it. Decoded `std::pmr` containers allocate from its `set_resource()` if given. It is
+ * reused across calls after a `reset()`
+ */
 template <typename Codec>
 concept Codeable = requires(Codec c, std::string s) {
   { c.template encode(s) } -> std::convertible_to<std::expected<void, typename Codec::Error>>;
   { c.template decode(s) } -> std::convertible_to<std::expected<void, typename Codec::Error>>;
-  { c.buffer() } -> std::convertible_to<std::stringstream&>;
+  { Codec::size_of(s) } -> std::convertible_to<size_t>;
+  { c.sink() } -> std::same_as<Sink&>;
+  { c.source() } -> std::same_as<Source&>;
+  c.set_resource(std::pmr::get_default_resource());
+  c.reset();
+};
+
+/**
+ * @brief A codec which encodes models front to back, never going back to fill in a size or an offset, so that the
+ * written bytes can be flushed as it goes, see `Sink::flush_to()`. All but the ones with `back_patches`
+ */
+template <typename Codec>
+concept Chunkable = Codeable<Codec> && !requires { requires Codec::back_patches; };
+
+namespace _impl {
+
+/**
+ * @brief Codec error
+ *
+ * @note The location is assembled by `at()` only while a failure unwinds, nothing is formatted on success
+ */
+struct Error {
+  std::string err_msg;
+  // field and array index path from the outermost model, e.g. `data.followers[3].name`
+  std::string path = {};
+
+  Error& at(std::string_view field);
+
+  Error& at(size_t index);
+
+  auto what() const -> std::string { return path.empty() ? err_msg : path + ": " + err_msg; }
+};
+
+template <typename Alloc>
+using String = std::basic_string<char, std::char_traits<char>, Alloc>;
+
+// element count of an array which is told only by its end, see `decode_array_begin()` of codecs
+inline constexpr size_t unknown_count = std::numeric_limits<size_t>::max();
+
+}  // namespace _impl
+
+/**
+ * @brief A field path from a model, as member pointers of the model and of the nested models down the path, e.g.
+ * `Path<&Message::data, &UserResponse::user, &User::id>`. A member of array of models applies to each element
+ */
+template <auto... Members>
+struct Path {
+  static_assert(sizeof...(Members) > 0, "empty field path");
 };
 
 namespace _impl {
 
-class TextCodec {
+template <typename... Paths>
+struct Selection {};
+
+template <auto A, auto B>
+constexpr bool same_member() {
+  if constexpr (std::is_same_v<decltype(A), decltype(B)>) {
+    return A == B;
+  } else {
+    return false;
+  }
+}
+
+// the rest of `P` below the field `Member`, if `P` goes through it
+template <auto Member, typename P>
+struct PathTail;
+
+template <auto Member, auto Head, auto... Rest>
+struct PathTail<Member, Path<Head, Rest...>> {
+  inline static constexpr bool whole = same_member<Member, Head>() && sizeof...(Rest) == 0;
+  using Type = std::conditional_t<same_member<Member, Head>() && (sizeof...(Rest) > 0), Selection<Path<Rest...>>,
+                                  Selection<>>;
+};
+
+template <typename... Selections>
+struct Join {
+  using Type = Selection<>;
+};
+
+template <typename... A, typename... B, typename... Rest>
+struct Join<Selection<A...>, Selection<B...>, Rest...> : Join<Selection<A..., B...>, Rest...> {};
+
+template <typename... A>
+struct Join<Selection<A...>> {
+  using Type = Selection<A...>;
+};
+
+/**
+ * @brief What of the field `Member` a selection of paths asks for: the whole value, nothing, or the `Type` selection
+ * of its nested fields
+ */
+template <auto Member, typename Selection>
+struct SubSelection;
+
+template <auto Member, typename... Paths>
+struct SubSelection<Member, Selection<Paths...>> {
+  using Type = typename Join<typename PathTail<Member, Paths>::Type...>::Type;
+
+  inline static constexpr bool whole = (PathTail<Member, Paths>::whole || ...);
+  inline static constexpr bool none = !whole && std::is_same_v<Type, Selection<>>;
+};
+
+// whether the path `P` starts at a codable field of `Model`
+template <typename Model, typename P>
+inline constexpr bool starts_at = false;
+
+template <typename Model, auto Head, auto... Rest>
+inline constexpr bool starts_at<Model, Path<Head, Rest...>> =
+    !Model::visit_fields([]<typename Field>(Field) { return !same_member<Field::pointer, Head>(); });
+
+/**
+ * @brief Runs of adjacent arithmetic fields of a model, which fixed width codecs encode and decode as one block
+ */
+template <typename Model>
+struct ArithmeticRuns {
+  // byte size of each field, 0 for other than arithmetic fields
+  inline static constexpr auto sizes = [] {
+    std::array<size_t, Model::field_count()> sizes;
+    Model::visit_fields([&sizes]<typename Field>(Field) {
+      using T = typename Field::Type;
+      return (sizes[Field::index] = std::is_arithmetic_v<T> ? sizeof(T) : 0, true);
+    });
+    return sizes;
+  }();
+
+  // number of fields of the run which starts at each field, 0 for fields which do not start a run
+  inline static constexpr auto lengths = [] {
+    std::array<size_t, Model::field_count()> lengths = {};
+    for (size_t i = 0; i < lengths.size(); ++i) {
+      for (size_t j = i; j < lengths.size() && sizes[j] > 0 && (i == 0 || sizes[i - 1] == 0); ++j) {
+        ++lengths[i];
+      }
+    }
+    return lengths;
+  }();
+
+  // byte offset of each field in its run
+  inline static constexpr auto offsets = [] {
+    std::array<size_t, Model::field_count()> offsets = {};
+    for (size_t i = 1; i < offsets.size(); ++i) {
+      offsets[i] = lengths[i] == 0 && sizes[i] > 0 ? offsets[i - 1] + sizes[i - 1] : 0;
+    }
+    return offsets;
+  }();
+
+  // byte size of the run which starts at each field
+  inline static constexpr auto bytes = [] {
+    std::array<size_t, Model::field_count()> bytes = {};
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      bytes[i] = lengths[i] > 0 ? offsets[i + lengths[i] - 1] + sizes[i + lengths[i] - 1] : 0;
+    }
+    return bytes;
+  }();
+};
+
+/**
+ * @brief Whether a `T` may take no byte at all in a codec which writes models as their fields only, that is a model
+ * whose fields all may, e.g. one without fields. Other values take one byte at least
+ */
+template <typename T>
+constexpr bool may_be_empty() {
+  if constexpr (requires { T::field_count(); }) {
+    return T::visit_fields([]<typename Field>(Field) { return may_be_empty<typename Field::Type>(); });
+  } else {
+    return false;
+  }
+}
+
+/**
+ * @brief Buffers and allocation state shared by all codecs
+ */
+class BaseCodec {
+ public:
+  auto sink() -> Sink& { return _sink; }
+
+  auto source() -> Source& { return _source; }
+
+  /**
+   * @brief Memory resource which decoded `std::pmr` strings and arrays allocate from, nullptr to keep their own
+   */
+  auto resource() const -> std::pmr::memory_resource* { return _resource; }
+
+  void set_resource(std::pmr::memory_resource* resource) { _resource = resource; }
+
+  /**
+   * @brief Back to the state of a new codec, buffers keep their capacity
+   */
+  void reset() {
+    _sink.reset();
+    _source.reset({});
+    _resource = nullptr;
+  }
+
+  /**
+   * @brief Bytes held by the buffers which are kept across calls
+   */
+  size_t capacity() const { return _sink.capacity(); }
+
+  /**
+   * @brief Free the buffers which are kept across calls, between calls only
+   */
+  void release() { _sink.release(); }
+
+ protected:
+  Sink _sink;
+  Source _source;
+  std::pmr::memory_resource* _resource = nullptr;
+
+  // write `count` numbers in `Order` as one block, or a chunk at a time into a chunked sink. Sink overflow is
+  // reported by the caller
+  template <std::endian Order, typename T>
+  void _write_numbers(const T* data, size_t count) {
+    size_t step = _sink.chunk_size() >= sizeof(T) ? _sink.chunk_size() / sizeof(T) : count;
+    for (size_t i = 0; i < count; i += step) {
+      size_t n = std::min(step, count - i);
+      char* dst = _sink.claim(n * sizeof(T));
+      if (!dst) {
+        return;
+      }
+      std::memcpy(dst, data + i, n * sizeof(T));
+      std::endian::native != Order ? simd::byteswap(dst, n, sizeof(T)) : void();
+    }
+  }
+
+  // make a container which is about to be decoded into allocate from `_resource`, if it is a pmr container.
+  // polymorphic allocators never propagate on assignment, so the container is recreated
+  template <typename Container>
+  void _rebind(Container& c) {
+    using Alloc = typename Container::allocator_type;
+    if constexpr (std::is_same_v<Alloc, std::pmr::polymorphic_allocator<typename Container::value_type>>) {
+      if (_resource && c.get_allocator().resource() != _resource) {
+        std::destroy_at(&c);
+        std::construct_at(&c, Alloc(_resource));
+      }
+    }
+  }
+};
+
+inline size_t decimal_digits(uint64_t v) {
+  size_t n = 1;
+  for (; v >= 10; v /= 10) {
+    ++n;
+  }
+  return n;
+}
+
+class TextCodec : public BaseCodec {
  public:
-  struct Error {
-    std::string err_msg;
-  };
+  using Error = _impl::Error;
+
+  // the unescaped string scratch and the token index are kept for the next message, see `CodecSession`
+  inline static constexpr bool keeps_scratch = true;
+
+  void reset() {
+    BaseCodec::reset();
+    _window = 0;
+    _window_end = nullptr;
+  }
+
+  size_t capacity() const {
+    return BaseCodec::capacity() + _scratch.capacity() + _tokens_capacity * sizeof(uint32_t);
+  }
+
+  void release() {
+    BaseCodec::release();
+    std::string().swap(_scratch);
+    _tokens.reset();
+    _tokens_capacity = 0;
+    reset();
+  }
+
+  auto encode(std::string_view str) -> std::expected<void, Error>;
 
-  auto buffer() -> std::stringstream& { return _ss; }
+  auto encode(const std::string& str) -> std::expected<void, Error> { return encode(std::string_view(str)); }
 
-  auto encode(const std::string& str) -> std::expected<void, Error>;
+  auto encode(const char* str) -> std::expected<void, Error> { return encode(std::string_view(str)); }
 
-  auto decode(std::string& str) -> std::expected<void, Error>;
+  /**
+   * @note The string is viewed in the source, or in a scratch buffer till the next decode if it has escape sequences
+   */
+  auto decode(std::string_view& str) -> std::expected<void, Error> {
+    auto view = _decode_string();
+    return view ? (str = *view, std::expected<void, Error>{}) : std::unexpected(std::move(view.error()));
+  }
 
-  auto encode(const char* str) -> std::expected<void, Error> { return encode(std::string(str)); }
+  template <typename Alloc>
+  auto decode(String<Alloc>& str) -> std::expected<void, Error> {
+    auto view = _decode_string();
+    if (!view) {
+      return std::unexpected(std::move(view.error()));
+    }
+    _rebind(str);
+    str.assign(*view);
+    return {};
+  }
 
   auto encode(bool b) -> std::expected<void, Error>;
 
   auto decode(bool& b) -> std::expected<void, Error>;
 
+  /**
+   * @brief An element of `std::vector<bool>`, which is a proxy of its bit
+   */
+  auto decode(std::vector<bool>::reference b) -> std::expected<void, Error> {
+    bool v;
+    auto r = decode(v);
+    return r ? (b = v, r) : r;
+  }
+
   template <typename T>
     requires std::is_arithmetic_v<T>
   auto encode(T num) -> std::expected<void, Error> {
@@ -51,30 +353,114 @@ class TextCodec {
                      : std::unexpected(Error(std::format("invalid bytes for {}", typeid(T).name())));
   }
 
- protected:
-  std::stringstream _ss;
+  /**
+   * @note Exact, escape sequences included
+   */
+  static size_t size_of(std::string_view str);
+
+  static size_t size_of(bool b) { return b ? 4 : 5; }
+
+  /**
+   * @note Exact for integers, an upper bound for floating points
+   */
+  template <typename T>
+    requires std::is_arithmetic_v<T>
+  static size_t size_of(T num) {
+    if constexpr (sizeof(T) == 1) {
+      return 1;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      // sign, shortest round trip digits, decimal point and exponent of the longest scientific form
+      return std::numeric_limits<T>::max_digits10 + (sizeof(T) <= 4 ? 6 : sizeof(T) <= 8 ? 7 : 8);
+    } else if constexpr (std::is_signed_v<T>) {
+      return num < 0 ? 1 + decimal_digits(0 - static_cast<uint64_t>(num)) : decimal_digits(num);
+    } else {
+      return decimal_digits(num);
+    }
+  }
 
+ protected:
   template <typename T>
   void _put(const T& v) {
-    _ss << v;
+    if constexpr (sizeof(T) == 1) {
+      // single byte types are written as characters, as `std::ostream` does
+      _sink.put(static_cast<char>(v));
+    } else {
+      // formatted aside, a fixed sink may have fewer than `_max_chars` bytes left but still enough for `v`
+      char buffer[_max_chars];
+      // the shortest output which reads back to the same value, floating points included
+      auto r = std::to_chars(buffer, buffer + _max_chars, v);
+      _sink.write(buffer, r.ptr - buffer);
+    }
   }
 
   template <typename T>
   bool _get(T& v) {
-    return (_ss >> v, _ss.good());
+    _drop_blanks();
+    if constexpr (sizeof(T) == 1) {
+      // single byte types are read as characters, as `std::istream` does
+      int c = _source.get();
+      v = static_cast<T>(c);
+      return c != Source::eof;
+    } else {
+      auto r = std::from_chars(_source.cursor(), _source.end(), v);
+      _source.seek(r.ptr);
+      return r.ec == std::errc();
+    }
   }
 
   // skip blanks and see next valid character
-  bool _see(char c);
+  bool _see(char c) {
+    _drop_blanks();
+    return _source.peek() == static_cast<unsigned char>(c);
+  }
+
+  // parse a quoted string, the content is viewed in the source, or in a scratch buffer till the next call if it has
+  // escape sequences
+  auto _decode_string() -> std::expected<std::string_view, Error>;
+
+  // skip a whole json value, nested objects and arrays are only checked for matching brackets
+  auto _skip_value() -> std::expected<void, Error>;
+
+  // skip blanks and eat next valid character, which is expected to be `c`
+  auto _eat(char c) -> std::expected<void, Error> {
+    if (!_see(c)) [[unlikely]] {
+      return std::unexpected(Error(std::format("expect char '{}'", c)));
+    }
+    _source.skip();
+    return {};
+  }
+
+  // the common case of no blank stays inline
+  void _drop_blanks() {
+    if (_is_blank(_source.peek())) [[unlikely]] {
+      _skip_blanks();
+    }
+  }
+
+  static bool _is_blank(int c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r'; }
+
+  void _skip_blanks();
 
-  auto _catch(std::function<void()>&& stats) -> std::expected<void, Error>;
+  // index JSON tokens of the source as soon as a blank shows up, then blank runs are jumped over instead of scanned
+  bool _tokenize = false;
 
-  void _try(std::expected<void, Error>&& ex, std::string&& msg);
+ private:
+  // enough for any arithmetic value written by `_put`
+  inline static constexpr size_t _max_chars = 32;
+
+  // indexed bytes a time, which doubles up to the max as a message goes on, so small messages index a few bytes only
+  inline static constexpr size_t _min_window = 1024;
+  inline static constexpr size_t _max_window = 64 * 1024;
 
-  // skip blanks and try to eat next valid character
-  void _try_eat(char c, std::string&& msg);
+  std::string _scratch;
 
-  void _drop_blanks();
+  std::unique_ptr<uint32_t[]> _tokens;
+  size_t _tokens_capacity = 0;
+  size_t _window = 0;
+  const char* _window_end = nullptr;
+
+  // index tokens from the cursor
+  void _index_tokens();
 };
 
 template <typename Codec>
@@ -82,102 +468,198 @@ class ArrayTextCodec : public TextCodec {
  public:
   using TextCodec::decode;
   using TextCodec::encode;
+  using TextCodec::size_of;
 
-  template <typename T>
-  auto encode(const std::vector<T>& arr) -> std::expected<void, Error> {
-    return _catch([this, &arr]() {
-      _put('[');
-      for (size_t i = 0; i < arr.size(); ++i) {
-        i > 0 ? _put(',') : void();
-        _try(static_cast<Codec*>(this)->encode(arr[i]), std::format("array[{}] encode", i));
-      }
-      _put(']');
-    });
+  template <typename T, typename Alloc>
+  static size_t size_of(const std::vector<T, Alloc>& arr) {
+    size_t size = arr.empty() ? 2 : 1 + arr.size();
+    for (const auto& v : arr) {
+      size += Codec::size_of(v);
+    }
+    return size;
   }
 
-  template <typename T>
-  auto decode(std::vector<T>& arr) -> std::expected<void, Error> {
-    return _catch([this, &arr]() mutable {
-      _try_eat('[', "array start");
-      arr.clear();
-      for (size_t i = 0; !_see(']'); ++i) {
-        !arr.empty() ? _try_eat(',', "array seperate") : void();
-        T val;
-        _try(static_cast<Codec*>(this)->decode(val), std::format("array[{}] decode", i));
-        arr.emplace_back(std::move(val));
-      }
-      _try_eat(']', "array end");
-    });
+  template <typename T, typename Alloc>
+  auto encode(const std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    _put('[');
+    for (size_t i = 0; i < arr.size(); ++i) {
+      i > 0 ? _put(',') : void();
+      if (auto r = static_cast<Codec*>(this)->encode(arr[i]); !r) {
+        r.error().at(i);
+        return r;
+      }
+    }
+    _put(']');
+    return {};
+  }
+
+  template <typename T, typename Alloc>
+  auto decode(std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    if (auto r = _eat('['); !r) {
+      return r;
+    }
+    _rebind(arr);
+    // existing elements are decoded into, to reuse their storage
+    size_t i = 0;
+    for (; !_see(']'); ++i) {
+      if (auto r = i > 0 ? _eat(',') : std::expected<void, Error>{}; !r) {
+        r.error().at(i);
+        return r;
+      }
+      i < arr.size() ? void() : void(arr.emplace_back());
+      if (auto r = static_cast<Codec*>(this)->decode(arr[i]); !r) {
+        r.error().at(i);
+        return r;
+      }
+    }
+    arr.resize(i);
+    return _eat(']');
+  }
+
+  // streaming primitives, which read and write the framing of arrays a piece at a time, see `transcode()`
+
+  /**
+   * @param T Element type, see the binary codecs
+   * @return Element count, or `unknown_count` if it is told only by the end of the array
+   */
+  template <typename T = void>
+  auto decode_array_begin() -> std::expected<size_t, Error> {
+    auto r = _eat('[');
+    return r ? std::expected<size_t, Error>(unknown_count) : std::unexpected(std::move(r.error()));
+  }
+
+  /**
+   * @return false at the end of the array
+   */
+  auto decode_element(size_t i) -> std::expected<bool, Error> {
+    if (_see(']')) {
+      return false;
+    }
+    auto r = i > 0 ? _eat(',') : std::expected<void, Error>{};
+    return r ? std::expected<bool, Error>(true) : std::unexpected(std::move(r.error()));
+  }
+
+  auto decode_array_end() -> std::expected<void, Error> { return _eat(']'); }
+
+  /**
+   * @return A mark to hand back to `encode_array_end()`
+   */
+  size_t encode_array_begin() { return (_put('['), 0); }
+
+  void encode_element(size_t i) { i > 0 ? _put(',') : void(); }
+
+  auto encode_array_end(size_t, size_t) -> std::expected<void, Error> {
+    _put(']');
+    return {};
   }
 };
 
-class BytesCodec {
+/**
+ * @param Order Byte order of numbers on the wire
+ */
+template <std::endian Order>
+class BytesCodec : public BaseCodec {
  public:
   using VariableLength = uint32_t;
 
-  struct Error {
-    std::string err_msg;
-  };
+  using Error = _impl::Error;
 
-  auto buffer() -> std::stringstream& { return _ss; }
+  auto encode(std::string_view value) -> std::expected<void, Error>;
 
-  auto encode(const std::string& value) -> std::expected<void, Error>;
+  /**
+   * @note The string is viewed in the source
+   */
+  auto decode(std::string_view& value) -> std::expected<void, Error> {
+    auto view = _decode_string();
+    return view ? (value = *view, std::expected<void, Error>{}) : std::unexpected(std::move(view.error()));
+  }
 
-  auto decode(std::string& value) -> std::expected<void, Error>;
+  template <typename Alloc>
+  auto decode(String<Alloc>& value) -> std::expected<void, Error> {
+    auto view = _decode_string();
+    if (!view) {
+      return std::unexpected(std::move(view.error()));
+    }
+    _rebind(value);
+    value.assign(*view);
+    return {};
+  }
 
   template <typename T>
     requires std::is_arithmetic_v<T>
   auto encode(T num) -> std::expected<void, Error> {
-    std::endian::native == std::endian::little ? _reverse_byte_order(reinterpret_cast<char*>(&num), sizeof(T)) : void();
-    _ss.write(reinterpret_cast<char*>(&num), sizeof(T));
+    num = _to_wire(num);
+    _sink.write(&num, sizeof(T));
     return {};
   }
 
   template <typename T>
     requires std::is_arithmetic_v<T>
   auto decode(T& num) -> std::expected<void, Error> {
-    _ss.read(reinterpret_cast<char*>(&num), sizeof(T));
-    if (_ss.gcount() != sizeof(T)) {
+    const char* bytes = _source.take(sizeof(T));
+    if (!bytes) {
       return std::unexpected(Error(std::format("invalid bytes for {}", typeid(T).name())));
     }
-    std::endian::native == std::endian::little ? _reverse_byte_order(reinterpret_cast<char*>(&num), sizeof(T)) : void();
+    std::memcpy(&num, bytes, sizeof(T));
+    num = _to_wire(num);
     return {};
   }
 
- protected:
-  std::stringstream _ss;
+  /**
+   * @brief An element of `std::vector<bool>`, which is a proxy of its bit
+   */
+  auto decode(std::vector<bool>::reference b) -> std::expected<void, Error> {
+    bool v;
+    auto r = decode(v);
+    return r ? (b = v, r) : r;
+  }
 
-  auto _catch(std::function<void()>&& stats) -> std::expected<void, Error>;
+  static size_t size_of(std::string_view value) { return _variable_length_size + value.size(); }
 
   template <typename T>
-  T _try(std::expected<T, Error>&& ex, std::string&& msg) {
-    if (!ex) {
-      throw Error(std::move(msg));
-    }
-    if constexpr (!std::is_same_v<T, void>) {
-      return std::move(ex.value());
-    }
+    requires std::is_arithmetic_v<T>
+  static size_t size_of(T) {
+    return sizeof(T);
   }
 
+ protected:
   template <typename T>
   auto _encode_varible_len(T len) -> std::expected<VariableLength, Error> {
     VariableLength u32 = len;
     if (u32 < len) {
       return std::unexpected(Error("variable length object (string and array) only support a maximum 4G elements"));
     }
-    _ss.write(&_variable_length_tag, 1);
+    _sink.put(_variable_length_tag);
     encode(u32);  // always success
     return u32;
   }
 
   auto _decode_variable_len() -> std::expected<VariableLength, Error>;
 
- private:
-  inline static constexpr char _variable_length_tag = 0xf1;
+  // the string content is viewed in the source
+  auto _decode_string() -> std::expected<std::string_view, Error>;
+
+  // tag and length
+  inline static constexpr size_t _variable_length_size = 1 + sizeof(VariableLength);
+
+  // the conversion between native and wire byte order, which is its own inverse
+  template <typename T>
+  static T _to_wire(T num) {
+    return std::endian::native != Order ? simd::byteswap(num) : num;
+  }
+
+  // convert `count` consecutive numbers of `T` in place
+  template <typename T>
+  static void _to_wire(char* data, size_t count) {
+    std::endian::native != Order ? simd::byteswap(data, count, sizeof(T)) : void();
+  }
 
-  void _reverse_byte_order(char* start, size_t size);
+  inline static constexpr char _variable_length_tag = 0xf1;
 };
 
+extern template class BytesCodec<std::endian::big>;
+extern template class BytesCodec<std::endian::little>;
+
 }  // namespace _impl
 
 /**
@@ -189,132 +671,1189 @@ class ReprCodec : public _impl::ArrayTextCodec<ReprCodec> {
  public:
   using ArrayTextCodec<ReprCodec>::decode;
   using ArrayTextCodec<ReprCodec>::encode;
+  using ArrayTextCodec<ReprCodec>::size_of;
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  static size_t size_of(const Model<Codec>& model) {
+    size_t size = Model<Codec>::field_count() > 0 ? 1 + Model<Codec>::field_count() : 2;
+    Model<Codec>::visit_fields([&model, &size]<typename Field>(Field) {
+      size += size_of(model.*Field::pointer);
+      return true;
+    });
+    return size;
+  }
 
   template <template <typename> typename Model, typename Codec>
     requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
   auto encode(const Model<Codec>& model) -> std::expected<void, Error> {
-    return _catch([this, &model]() {
-      auto& fields = Model<ReprCodec>::fields();
-      _put('(');
-      for (size_t i = 0; i < fields.size(); ++i) {
-        i > 0 ? _put(',') : void();
-        _try(fields[i]->dump(&model, *this),
-             std::format("{}::{} encode", typeid(Model<Codec>).name(), fields[i]->name()));
-      }
-      _put(')');
+    std::expected<void, Error> res;
+    _put('(');
+    Model<Codec>::visit_fields([this, &model, &res]<typename Field>(Field) {
+      Field::index > 0 ? _put(',') : void();
+      res = encode(model.*Field::pointer);
+      return res || (res.error().at(Field::name), false);
     });
+    if (res) {
+      _put(')');
+    }
+    return res;
   }
 
   template <template <typename> typename Model, typename Codec>
     requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
   auto decode(Model<Codec>& model) -> std::expected<void, Error> {
-    return _catch([this, &model]() mutable {
-      auto& fields = Model<ReprCodec>::fields();
-      _try_eat('(', "model start");
-      for (size_t i = 0; i < fields.size(); ++i) {
-        i > 0 ? _try_eat(',', "model seperate") : void();
-        _try(fields[i]->load(&model, *this),
-             std::format("{}::{} decode", typeid(Model<Codec>).name(), fields[i]->name()));
-      }
-      _try_eat(')', "model end");
+    std::expected<void, Error> res = _eat('(');
+    res && Model<Codec>::visit_fields([this, &model, &res]<typename Field>(Field) {
+      if (Field::index > 0) {
+        res = _eat(',');
+      }
+      if (res) {
+        res = decode(model.*Field::pointer);
+      }
+      return res || (res.error().at(Field::name), false);
     });
+    return res ? _eat(')') : res;
+  }
+
+  // streaming primitives of models, false if the input is not as expected, and the model is to be decoded as a whole
+  // which tells the failure
+
+  bool decode_model_begin() { return _eat('(').has_value(); }
+
+  template <typename Field>
+  bool decode_field() {
+    return Field::index == 0 || _eat(',');
+  }
+
+  bool decode_model_end() { return _eat(')').has_value(); }
+
+  void encode_model_begin() { _put('('); }
+
+  template <typename Field>
+  void encode_field() {
+    Field::index > 0 ? _put(',') : void();
   }
+
+  void encode_model_end() { _put(')'); }
 };
 
+/**
+ * @note Object keys are matched by name in any order, unknown ones are skipped with their values, a repeated one
+ * fails, and fields without a key are reset to their defaults. Pretty printed input is decoded with the help of a
+ * structural index, which is built in one vectorized pass and lets the parser jump from token to token
+ */
 class JsonCodec : public _impl::ArrayTextCodec<JsonCodec> {
  public:
+  JsonCodec() { _tokenize = true; }
+
   using ArrayTextCodec<JsonCodec>::decode;
   using ArrayTextCodec<JsonCodec>::encode;
+  using ArrayTextCodec<JsonCodec>::size_of;
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  static size_t size_of(const Model<Codec>& model) {
+    size_t size = Model<Codec>::field_count() > 0 ? 1 + Model<Codec>::field_count() : 2;
+    Model<Codec>::visit_fields([&model, &size]<typename Field>(Field) {
+      // quoted key and colon
+      size += size_of(Field::name) + 1 + size_of(model.*Field::pointer);
+      return true;
+    });
+    return size;
+  }
 
   template <template <typename> typename Model, typename Codec>
     requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
   auto encode(const Model<Codec>& model) -> std::expected<void, Error> {
-    return _catch([this, &model]() {
-      auto& fields = Model<JsonCodec>::fields();
-      _put('{');
-      for (size_t i = 0; i < fields.size(); ++i) {
-        i > 0 ? _put(',') : void();
-        _try(encode(fields[i]->name()),
-             std::format("{}::{} encode key", typeid(Model<Codec>).name(), fields[i]->name()));
-        _put(':');
-        _try(fields[i]->dump(&model, *this),
-             std::format("{}::{} encode value", typeid(Model<Codec>).name(), fields[i]->name()));
-      }
-      _put('}');
+    std::expected<void, Error> res;
+    _put('{');
+    Model<Codec>::visit_fields([this, &model, &res]<typename Field>(Field) {
+      Field::index > 0 ? _put(',') : void();
+      encode(Field::name);  // always success
+      _put(':');
+      res = encode(model.*Field::pointer);
+      return res || (res.error().at(Field::name), false);
     });
+    if (res) {
+      _put('}');
+    }
+    return res;
   }
 
   template <template <typename> typename Model, typename Codec>
     requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
   auto decode(Model<Codec>& model) -> std::expected<void, Error> {
-    return _catch([this, &model]() mutable {
-      auto& fields = Model<JsonCodec>::fields();
-      _try_eat('{', "model start");
-      for (size_t i = 0; i < fields.size(); ++i) {
-        i > 0 ? _try_eat(',', "model separate") : void();
-        std::string name;
-        _try(decode(name), std::format("{}::{} decode key", typeid(Model<Codec>).name(), fields[i]->name()));
-        _try_eat(':', "model colon");
-        _try(fields[i]->load(&model, *this),
-             std::format("{}::{} decode value", typeid(Model<Codec>).name(), fields[i]->name()));
-      }
-      _try_eat('}', "model end");
+    std::expected<void, Error> res = _eat('{');
+    // keys arriving in declaration order are matched at the first try
+    size_t next = 0;
+    std::array<bool, Model<Codec>::field_count()> seen = {};
+    for (bool first = true; res && !_see('}'); first = false) {
+      if (!first && !(res = _eat(','))) {
+        break;
+      }
+      auto key = _decode_string();
+      if (!key) {
+        return std::unexpected(std::move(key.error()));
+      }
+      if (!(res = _eat(':'))) {
+        break;
+      }
+      size_t index = Model<Codec>::field_index(*key, next);
+      if (index == Model<Codec>::field_count()) {
+        // copied for the error path, an unescaped key is viewed in the scratch which the skipped value reuses
+        std::string unknown(*key);
+        res = _skip_value();
+        res || (res.error().at(unknown), false);
+        continue;
+      }
+      if (seen[index]) {
+        res = std::unexpected(Error("duplicate key"));
+        res.error().at(*key);
+        break;
+      }
+      seen[index] = true;
+      next = index + 1;
+      Model<Codec>::visit_fields([this, &model, &res, index]<typename Field>(Field) {
+        if (Field::index != index) {
+          return true;
+        }
+        res = decode(model.*Field::pointer);
+        return res || (res.error().at(Field::name), false);
+      });
+    }
+    if (!res) {
+      return res;
+    }
+    // assigned, so that strings and arrays of a reused model keep their storage
+    Model<Codec>::visit_fields([&model, &seen]<typename Field>(Field) {
+      if (!seen[Field::index]) {
+        model.*Field::pointer = Model<Codec>::defaults().*Field::pointer;
+      }
+      return true;
     });
+    return _eat('}');
+  }
+
+  // streaming primitives of models, false if the input is not as expected, e.g. keys out of the declaration order,
+  // and the model is to be decoded as a whole
+
+  bool decode_model_begin() { return _eat('{').has_value(); }
+
+  template <typename Field>
+  bool decode_field() {
+    if (_see('}') || (Field::index > 0 && !_eat(','))) {
+      return false;
+    }
+    auto key = _decode_string();
+    return key && *key == Field::name && _eat(':');
+  }
+
+  bool decode_model_end() { return _eat('}').has_value(); }
+
+  void encode_model_begin() { _put('{'); }
+
+  template <typename Field>
+  void encode_field() {
+    Field::index > 0 ? _put(',') : void();
+    encode(Field::name);  // always success
+    _put(':');
   }
+
+  void encode_model_end() { _put('}'); }
 };
 
 /**
  * @brief A binary codec. Suitable for large numeric object
  *
+ * @param Order Byte order of numbers on the wire, hosts of the same byte order do no conversion at all
  * @note Decode destination object may come into invalid status if decode failed
  */
-class BinaryCodec : public _impl::BytesCodec {
+template <std::endian Order>
+class BasicBinaryCodec : public _impl::BytesCodec<Order> {
+  using Base = _impl::BytesCodec<Order>;
+
  public:
-  using BytesCodec::decode;
-  using BytesCodec::encode;
+  using typename Base::Error;
+  using typename Base::VariableLength;
 
-  template <typename T>
-  auto encode(const std::vector<T>& arr) -> std::expected<void, Error> {
-    return _catch([this, &arr]() {
-      VariableLength len = _try(_encode_varible_len(arr.size()), "array encode");
-      for (VariableLength i = 0; i < len; ++i) {
-        _try(encode(arr[i]), std::format("array[{}] encode", i));
+  using Base::decode;
+  using Base::encode;
+  using Base::size_of;
+
+  // byte order of numbers on the wire
+  inline static constexpr std::endian order = Order;
+
+  // the leading tag of strings and arrays
+  inline static constexpr char length_tag = Base::_variable_length_tag;
+
+  template <typename T, typename Alloc>
+  static size_t size_of(const std::vector<T, Alloc>& arr) {
+    if constexpr (_is_bulk<T>) {
+      return Base::_variable_length_size + arr.size() * sizeof(T);
+    } else {
+      size_t size = Base::_variable_length_size;
+      for (const auto& v : arr) {
+        size += size_of(v);
       }
+      return size;
+    }
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  static size_t size_of(const Model<Codec>& model) {
+    size_t size = 0;
+    Model<Codec>::visit_fields([&model, &size]<typename Field>(Field) {
+      size += size_of(model.*Field::pointer);
+      return true;
     });
+    return size;
   }
 
-  template <typename T>
-  auto decode(std::vector<T>& arr) -> std::expected<void, Error> {
-    return _catch([this, &arr]() mutable {
-      VariableLength len = _try(_decode_variable_len(), "array decode");
-      arr.clear();
-      for (VariableLength i = 0; i < len; ++i) {
-        T val;
-        _try(decode(val), std::format("array[{}] decode", i));
-        arr.emplace_back(std::move(val));
+  template <typename T, typename Alloc>
+  auto encode(const std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    auto len = this->_encode_varible_len(arr.size());
+    if (!len) {
+      return std::unexpected(std::move(len.error()));
+    }
+    if constexpr (_is_bulk<T>) {
+      this->template _write_numbers<Order>(arr.data(), arr.size());
+      return {};
+    }
+    for (VariableLength i = 0; i < *len; ++i) {
+      if (auto r = encode(arr[i]); !r) {
+        r.error().at(i);
+        return r;
       }
-    });
+    }
+    return {};
+  }
+
+  template <typename T, typename Alloc>
+  auto decode(std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    auto len = this->_decode_variable_len();
+    if (!len) {
+      return std::unexpected(std::move(len.error()));
+    }
+    this->_rebind(arr);
+    if constexpr (_is_bulk<T>) {
+      const char* src = this->_source.take(size_t(*len) * sizeof(T));
+      if (!src) {
+        return std::unexpected(Error(std::format("insufficient bytes for {} array elements", *len)));
+      }
+      arr.resize(*len);
+      if (!arr.empty()) {
+        std::memcpy(arr.data(), src, arr.size() * sizeof(T));
+      }
+      Base::template _to_wire<T>(reinterpret_cast<char*>(arr.data()), arr.size());
+      return {};
+    }
+    if (!_impl::may_be_empty<T>() && *len > this->_source.remaining()) {
+      // every element takes one byte at least
+      return std::unexpected(Error("invalid array length"));
+    }
+    // existing elements are decoded into, to reuse their storage
+    arr.resize(*len);
+    for (VariableLength i = 0; i < *len; ++i) {
+      if (auto r = decode(arr[i]); !r) {
+        r.error().at(i);
+        return r;
+      }
+    }
+    return {};
   }
 
   template <template <typename> typename Model, typename Codec>
     requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
   auto encode(const Model<Codec>& model) -> std::expected<void, Error> {
-    return _catch([this, &model]() {
-      for (auto& field : Model<BinaryCodec>::fields()) {
-        _try(field->dump(&model, *this), std::format("{}::{} encode", typeid(Model<Codec>).name(), field->name()));
+    using Runs = _impl::ArithmeticRuns<Model<Codec>>;
+    std::expected<void, Error> res;
+    Model<Codec>::visit_fields([this, &model, &res]<typename Field>(Field) {
+      if constexpr (Runs::lengths[Field::index] > 1) {
+        _encode_run<Field::index, Runs::lengths[Field::index]>(model);
+        return true;
+      } else if constexpr (Runs::lengths[Field::index] == 0 && Runs::sizes[Field::index] > 0) {
+        // written with its run
+        return true;
+      } else {
+        res = encode(model.*Field::pointer);
+        return res || (res.error().at(Field::name), false);
       }
     });
+    return res;
   }
 
   template <template <typename> typename Model, typename Codec>
     requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
   auto decode(Model<Codec>& model) -> std::expected<void, Error> {
-    return _catch([this, &model]() mutable {
-      for (auto& field : Model<BinaryCodec>::fields()) {
-        _try(field->load(&model, *this), std::format("{}::{} decode", typeid(Model<Codec>).name(), field->name()));
+    using Runs = _impl::ArithmeticRuns<Model<Codec>>;
+    std::expected<void, Error> res;
+    // the run a field is read with, if any
+    bool in_run = false;
+    Model<Codec>::visit_fields([this, &model, &res, &in_run]<typename Field>(Field) {
+      if constexpr (Runs::lengths[Field::index] > 0) {
+        in_run = Runs::lengths[Field::index] > 1 && _decode_run<Field::index, Runs::lengths[Field::index]>(model);
       }
+      if (!(in_run && Runs::sizes[Field::index] > 0)) {
+        // one by one, which also tells the field of a run failed
+        res = decode(model.*Field::pointer);
+      }
+      return res || (res.error().at(Field::name), false);
     });
+    return res;
+  }
+
+  // streaming primitives, which read and write the framing of arrays and models a piece at a time, see `transcode()`
+
+  /**
+   * @param T Element type
+   * @return Element count
+   */
+  template <typename T = void>
+  auto decode_array_begin() -> std::expected<size_t, Error> {
+    auto len = this->_decode_variable_len();
+    if (len && !_impl::may_be_empty<T>() && *len > this->_source.remaining()) {
+      // every element takes one byte at least
+      return std::unexpected(Error("invalid array length"));
+    }
+    return len;
+  }
+
+  auto decode_element(size_t) -> std::expected<bool, Error> { return true; }
+
+  auto decode_array_end() -> std::expected<void, Error> { return {}; }
+
+  /**
+   * @return A mark to hand back to `encode_array_end()`, where the length is patched
+   */
+  size_t encode_array_begin() {
+    this->_sink.put(Base::_variable_length_tag);
+    size_t mark = this->_sink.size();
+    encode(VariableLength(0));
+    return mark;
+  }
+
+  void encode_element(size_t) {}
+
+  auto encode_array_end(size_t mark, size_t count) -> std::expected<void, Error> {
+    VariableLength len = count;
+    if (len < count) {
+      return std::unexpected(Error("variable length object (string and array) only support a maximum 4G elements"));
+    }
+    len = Base::_to_wire(len);
+    this->_sink.patch(mark, &len, sizeof(len));
+    return {};
+  }
+
+  bool decode_model_begin() { return true; }
+
+  template <typename Field>
+  bool decode_field() {
+    return true;
+  }
+
+  bool decode_model_end() { return true; }
+
+  void encode_model_begin() {}
+
+  template <typename Field>
+  void encode_field() {}
+
+  void encode_model_end() {}
+
+ private:
+  // encode the run of `N` arithmetic fields from the `I`-th into one block, with the byte offsets known at compile time
+  template <size_t I, size_t N, typename Model>
+  void _encode_run(const Model& model) {
+    using Runs = _impl::ArithmeticRuns<Model>;
+    // sink overflow is reported by the caller
+    if (char* dst = this->_sink.claim(Runs::bytes[I]); dst) {
+      Model::visit_fields([dst, &model]<typename Field>(Field) {
+        if constexpr (Field::index >= I && Field::index < I + N) {
+          _store(dst + Runs::offsets[Field::index], model.*Field::pointer);
+        }
+        return true;
+      });
+    }
+  }
+
+  // decode the run of `N` arithmetic fields from the `I`-th from one block
+  template <size_t I, size_t N, typename Model>
+  bool _decode_run(Model& model) {
+    using Runs = _impl::ArithmeticRuns<Model>;
+    const char* src = this->_source.take(Runs::bytes[I]);
+    if (src) {
+      Model::visit_fields([src, &model]<typename Field>(Field) {
+        if constexpr (Field::index >= I && Field::index < I + N) {
+          _load(src + Runs::offsets[Field::index], model.*Field::pointer);
+        }
+        return true;
+      });
+    }
+    return src;
+  }
+
+  template <typename T>
+  static void _store(char* dst, T num) {
+    num = Base::_to_wire(num);
+    std::memcpy(dst, &num, sizeof(T));
+  }
+
+  template <typename T>
+  static void _load(const char* src, T& num) {
+    std::memcpy(&num, src, sizeof(T));
+    num = Base::_to_wire(num);
+  }
+
+  // arrays of these element types are copied as a whole, `bool` is excluded since not every byte is a valid `bool`
+  template <typename T>
+  inline static constexpr bool _is_bulk = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+};
+
+/**
+ * @brief A compact binary codec. Suitable for objects of mostly small integers, e.g. ids and counters
+ *
+ * @note Integers wider than a byte, string and array lengths are LEB128 varints, zigzag encoded for signed
+ * integers. Floating points are little endian. Not wire compatible with `BinaryCodec`.
+ * Decode destination object may come into invalid status if decode failed
+ */
+class CompactBinaryCodec : public _impl::BaseCodec {
+ public:
+  using Error = _impl::Error;
+
+  auto encode(std::string_view value) -> std::expected<void, Error>;
+
+  /**
+   * @note The string is viewed in the source
+   */
+  auto decode(std::string_view& value) -> std::expected<void, Error> {
+    auto view = _decode_string();
+    return view ? (value = *view, std::expected<void, Error>{}) : std::unexpected(std::move(view.error()));
+  }
+
+  template <typename Alloc>
+  auto decode(_impl::String<Alloc>& value) -> std::expected<void, Error> {
+    auto view = _decode_string();
+    if (!view) {
+      return std::unexpected(std::move(view.error()));
+    }
+    _rebind(value);
+    value.assign(*view);
+    return {};
+  }
+
+  static size_t size_of(std::string_view value) { return _varint_size(value.size()) + value.size(); }
+
+  template <typename T>
+    requires std::is_arithmetic_v<T>
+  static size_t size_of(T num) {
+    if constexpr (_is_raw<T>) {
+      return sizeof(T);
+    } else if constexpr (std::is_signed_v<T>) {
+      return _varint_size(_zigzag(num));
+    } else {
+      return _varint_size(num);
+    }
+  }
+
+  template <typename T, typename Alloc>
+  static size_t size_of(const std::vector<T, Alloc>& arr) {
+    if constexpr (_is_raw<T>) {
+      return _varint_size(arr.size()) + arr.size() * sizeof(T);
+    } else {
+      size_t size = _varint_size(arr.size());
+      for (const auto& v : arr) {
+        size += size_of(v);
+      }
+      return size;
+    }
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  static size_t size_of(const Model<Codec>& model) {
+    size_t size = 0;
+    Model<Codec>::visit_fields([&model, &size]<typename Field>(Field) {
+      size += size_of(model.*Field::pointer);
+      return true;
+    });
+    return size;
+  }
+
+  template <typename T>
+    requires std::is_arithmetic_v<T>
+  auto encode(T num) -> std::expected<void, Error> {
+    if constexpr (_is_raw<T>) {
+      num = _to_wire(num);
+      _sink.write(&num, sizeof(T));
+    } else if constexpr (std::is_signed_v<T>) {
+      _put_varint(_zigzag(num));
+    } else {
+      _put_varint(num);
+    }
+    return {};
+  }
+
+  template <typename T>
+    requires std::is_arithmetic_v<T>
+  auto decode(T& num) -> std::expected<void, Error> {
+    if constexpr (_is_raw<T>) {
+      const char* bytes = _source.take(sizeof(T));
+      if (bytes) {
+        std::memcpy(&num, bytes, sizeof(T));
+        num = _to_wire(num);
+        return {};
+      }
+    } else if (uint64_t u; _get_varint(u)) {
+      if constexpr (std::is_signed_v<T>) {
+        int64_t i = static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+        num = static_cast<T>(i);
+        if (num == i) {
+          return {};
+        }
+      } else {
+        num = static_cast<T>(u);
+        if (num == u) {
+          return {};
+        }
+      }
+    }
+    return std::unexpected(Error(std::format("invalid bytes for {}", typeid(T).name())));
+  }
+
+  /**
+   * @brief An element of `std::vector<bool>`, which is a proxy of its bit
+   */
+  auto decode(std::vector<bool>::reference b) -> std::expected<void, Error> {
+    bool v;
+    auto r = decode(v);
+    return r ? (b = v, r) : r;
+  }
+
+  template <typename T, typename Alloc>
+  auto encode(const std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    _put_varint(arr.size());
+    if constexpr (_is_raw<T> && !std::is_same_v<T, bool>) {
+      _write_numbers<std::endian::little>(arr.data(), arr.size());
+      return {};
+    }
+    for (size_t i = 0; i < arr.size(); ++i) {
+      if (auto r = encode(arr[i]); !r) {
+        r.error().at(i);
+        return r;
+      }
+    }
+    return {};
+  }
+
+  template <typename T, typename Alloc>
+  auto decode(std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    uint64_t len;
+    if (!_get_varint(len) || (!_impl::may_be_empty<T>() && len > _source.remaining())) {
+      // every element takes one byte at least
+      return std::unexpected(Error("invalid array length"));
+    }
+    _rebind(arr);
+    if constexpr (_is_raw<T> && !std::is_same_v<T, bool>) {
+      const char* src = _source.take(len * sizeof(T));
+      if (!src) {
+        return std::unexpected(Error(std::format("insufficient bytes for {} array elements", len)));
+      }
+      arr.resize(len);
+      if (!arr.empty()) {
+        std::memcpy(arr.data(), src, arr.size() * sizeof(T));
+      }
+      std::endian::native != std::endian::little
+          ? _impl::simd::byteswap(reinterpret_cast<char*>(arr.data()), arr.size(), sizeof(T))
+          : void();
+      return {};
+    }
+    // existing elements are decoded into, to reuse their storage
+    arr.resize(len);
+    for (size_t i = 0; i < len; ++i) {
+      if (auto r = decode(arr[i]); !r) {
+        r.error().at(i);
+        return r;
+      }
+    }
+    return {};
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  auto encode(const Model<Codec>& model) -> std::expected<void, Error> {
+    std::expected<void, Error> res;
+    Model<Codec>::visit_fields([this, &model, &res]<typename Field>(Field) {
+      res = encode(model.*Field::pointer);
+      return res || (res.error().at(Field::name), false);
+    });
+    return res;
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  auto decode(Model<Codec>& model) -> std::expected<void, Error> {
+    std::expected<void, Error> res;
+    Model<Codec>::visit_fields([this, &model, &res]<typename Field>(Field) {
+      res = decode(model.*Field::pointer);
+      return res || (res.error().at(Field::name), false);
+    });
+    return res;
+  }
+
+  // streaming primitives, which read and write the framing of arrays and models a piece at a time, see `transcode()`
+
+  /**
+   * @param T Element type
+   * @return Element count
+   */
+  template <typename T = void>
+  auto decode_array_begin() -> std::expected<size_t, Error> {
+    uint64_t len;
+    if (!_get_varint(len) || (!_impl::may_be_empty<T>() && len > _source.remaining())) {
+      return std::unexpected(Error("invalid array length"));
+    }
+    return len;
+  }
+
+  auto decode_element(size_t) -> std::expected<bool, Error> { return true; }
+
+  auto decode_array_end() -> std::expected<void, Error> { return {}; }
+
+  /**
+   * @return A mark to hand back to `encode_array_end()`, where the length is inserted
+   */
+  size_t encode_array_begin() { return _sink.size(); }
+
+  void encode_element(size_t) {}
+
+  auto encode_array_end(size_t mark, size_t count) -> std::expected<void, Error> {
+    char buffer[_max_varint];
+    _sink.insert(mark, buffer, _format_varint(count, buffer));
+    return {};
+  }
+
+  bool decode_model_begin() { return true; }
+
+  template <typename Field>
+  bool decode_field() {
+    return true;
+  }
+
+  bool decode_model_end() { return true; }
+
+  void encode_model_begin() {}
+
+  template <typename Field>
+  void encode_field() {}
+
+  void encode_model_end() {}
+
+ protected:
+  // the string content is viewed in the source
+  auto _decode_string() -> std::expected<std::string_view, Error>;
+
+  void _put_varint(uint64_t v) {
+    // formatted aside, see `TextCodec::_put`
+    char buffer[_max_varint];
+    _sink.write(buffer, _format_varint(v, buffer));
+  }
+
+  static size_t _format_varint(uint64_t v, char* buffer) {
+    size_t n = 0;
+    for (; v >= 0x80; v >>= 7) {
+      buffer[n++] = static_cast<char>(v | 0x80);
+    }
+    buffer[n++] = static_cast<char>(v);
+    return n;
+  }
+
+  bool _get_varint(uint64_t& v) {
+    v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      int c = _source.get();
+      if (c == Source::eof) {
+        return false;
+      }
+      if (shift == 63 && (c & 0x7e)) {
+        // the 10th byte holds the top bit only
+        return false;
+      }
+      v |= static_cast<uint64_t>(c & 0x7f) << shift;
+      if (!(c & 0x80)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <typename T>
+  static T _to_wire(T num) {
+    return std::endian::native != std::endian::little ? _impl::simd::byteswap(num) : num;
+  }
+
+  static uint64_t _zigzag(int64_t num) { return (static_cast<uint64_t>(num) << 1) ^ static_cast<uint64_t>(num >> 63); }
+
+  static size_t _varint_size(uint64_t v) { return std::max<size_t>(1, (std::bit_width(v) + 6) / 7); }
+
+ private:
+  // floating points and single byte values are copied as they are, other integers are varints
+  template <typename T>
+  inline static constexpr bool _is_raw = std::is_floating_point_v<T> || (std::is_arithmetic_v<T> && sizeof(T) == 1);
+
+  inline static constexpr size_t _max_varint = 10;
+};
+
+/**
+ * @brief The big endian binary codec
+ */
+using BinaryCodec = BasicBinaryCodec<std::endian::big>;
+
+/**
+ * @brief The little endian binary codec, which copies numbers as they are on x86 and most ARM hosts
+ *
+ * @note Not wire compatible with `BinaryCodec`
+ */
+using LittleEndianBinaryCodec = BasicBinaryCodec<std::endian::little>;
+
+/**
+ * @brief A little endian binary codec whose nested models and arrays carry their byte sizes, so a decoder can jump
+ * over any value without decoding it. Decodes a subset of fields with `BaseModel::decode_fields`
+ *
+ * @note Numbers and strings are laid out as `LittleEndianBinaryCodec`. A model is prefixed with the u32 byte size of
+ * its fields, bytes beyond its known fields are ignored. An array of non-arithmetic elements is its length, the u32
+ * byte size of its elements, then the elements. Not wire compatible with other codecs.
+ * Decode destination object may come into invalid status if decode failed
+ */
+class SizedBinaryCodec : public _impl::BytesCodec<std::endian::little> {
+  using Base = _impl::BytesCodec<std::endian::little>;
+
+ public:
+  // sizes are patched in once the bytes they cover are written
+  inline static constexpr bool back_patches = true;
+
+  using Base::decode;
+  using Base::encode;
+  using Base::size_of;
+
+  template <typename T, typename Alloc>
+  static size_t size_of(const std::vector<T, Alloc>& arr) {
+    if constexpr (_is_bulk<T>) {
+      return _variable_length_size + arr.size() * sizeof(T);
+    } else {
+      size_t size = _variable_length_size + sizeof(uint32_t);
+      for (const auto& v : arr) {
+        size += size_of(v);
+      }
+      return size;
+    }
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  static size_t size_of(const Model<Codec>& model) {
+    size_t size = sizeof(uint32_t);
+    Model<Codec>::visit_fields([&model, &size]<typename Field>(Field) {
+      size += size_of(model.*Field::pointer);
+      return true;
+    });
+    return size;
+  }
+
+  template <typename T, typename Alloc>
+  auto encode(const std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    auto len = _encode_varible_len(arr.size());
+    if (!len) {
+      return std::unexpected(std::move(len.error()));
+    }
+    if constexpr (_is_bulk<T>) {
+      // written as one block, sink overflow is reported by the caller
+      if (char* dst = _sink.claim(arr.size() * sizeof(T)); dst && !arr.empty()) {
+        std::memcpy(dst, arr.data(), arr.size() * sizeof(T));
+        _to_wire<T>(dst, arr.size());
+      }
+      return {};
+    }
+    size_t at = _begin_sized();
+    for (VariableLength i = 0; i < *len; ++i) {
+      if (auto r = encode(arr[i]); !r) {
+        r.error().at(i);
+        return r;
+      }
+    }
+    return _end_sized(at);
+  }
+
+  template <typename T, typename Alloc>
+  auto decode(std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    return _decode_array(arr, [this](auto&& v) { return decode(v); });
+  }
+
+  template <typename T, typename Alloc, typename... Paths>
+  auto decode(std::vector<T, Alloc>& arr, _impl::Selection<Paths...> selection) -> std::expected<void, Error> {
+    return _decode_array(arr, [this, selection](auto&& v) { return decode(v, selection); });
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  auto encode(const Model<Codec>& model) -> std::expected<void, Error> {
+    size_t at = _begin_sized();
+    std::expected<void, Error> res;
+    Model<Codec>::visit_fields([this, &model, &res]<typename Field>(Field) {
+      res = encode(model.*Field::pointer);
+      return res || (res.error().at(Field::name), false);
+    });
+    return res ? _end_sized(at) : res;
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  auto decode(Model<Codec>& model) -> std::expected<void, Error> {
+    return _decode_sized([this, &model]() {
+      std::expected<void, Error> res;
+      Model<Codec>::visit_fields([this, &model, &res]<typename Field>(Field) {
+        res = decode(model.*Field::pointer);
+        return res || (res.error().at(Field::name), false);
+      });
+      return res;
+    });
+  }
+
+  /**
+   * @brief Decode the selected fields of `model`, and jump over the others
+   */
+  template <template <typename> typename Model, typename Codec, typename... Paths>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  auto decode(Model<Codec>& model, _impl::Selection<Paths...>) -> std::expected<void, Error> {
+    static_assert((_impl::starts_at<Model<Codec>, Paths> && ...), "path member is not a codable field of its model");
+    return _decode_sized([this, &model]() {
+      std::expected<void, Error> res;
+      Model<Codec>::visit_fields([this, &model, &res]<typename Field>(Field) {
+        using Sub = _impl::SubSelection<Field::pointer, _impl::Selection<Paths...>>;
+        if constexpr (Sub::whole) {
+          res = decode(model.*Field::pointer);
+        } else if constexpr (Sub::none) {
+          res = _skip<typename Field::Type>();
+        } else {
+          res = decode(model.*Field::pointer, typename Sub::Type{});
+        }
+        return res || (res.error().at(Field::name), false);
+      });
+      return res;
+    });
+  }
+
+ private:
+  template <typename T>
+  inline static constexpr bool _is_bulk = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+  // write a size placeholder, which is patched by `_end_sized(at)` with the size of bytes written after it
+  size_t _begin_sized() {
+    encode(uint32_t(0));
+    return _sink.size();
+  }
+
+  auto _end_sized(size_t at) -> std::expected<void, Error> {
+    size_t size = _sink.size() - at;
+    if (size > UINT32_MAX) {
+      return std::unexpected(Error("sized object only support a maximum 4G bytes"));
+    }
+    auto wire = _to_wire(static_cast<uint32_t>(size));
+    _sink.patch(at - sizeof(wire), &wire, sizeof(wire));
+    return {};
+  }
+
+  // call `func` to decode the content of a sized object, and move to the end of it
+  template <typename Func>
+  auto _decode_sized(Func&& func) -> std::expected<void, Error> {
+    uint32_t size;
+    if (auto r = decode(size); !r) {
+      return r;
+    }
+    if (size > _source.remaining()) {
+      return std::unexpected(Error("insufficient bytes for sized object"));
+    }
+    const char* end = _source.cursor() + size;
+    if (auto r = func(); !r) {
+      return r;
+    }
+    if (_source.cursor() > end) {
+      return std::unexpected(Error("content overruns its size"));
+    }
+    _source.seek(end);
+    return {};
+  }
+
+  template <typename T, typename Alloc, typename Func>
+  auto _decode_array(std::vector<T, Alloc>& arr, Func&& decode_element) -> std::expected<void, Error> {
+    auto len = _decode_variable_len();
+    if (!len) {
+      return std::unexpected(std::move(len.error()));
+    }
+    _rebind(arr);
+    if constexpr (_is_bulk<T>) {
+      const char* src = _source.take(size_t(*len) * sizeof(T));
+      if (!src) {
+        return std::unexpected(Error(std::format("insufficient bytes for {} array elements", *len)));
+      }
+      arr.resize(*len);
+      if (!arr.empty()) {
+        std::memcpy(arr.data(), src, arr.size() * sizeof(T));
+      }
+      _to_wire<T>(reinterpret_cast<char*>(arr.data()), arr.size());
+      return {};
+    } else {
+      return _decode_sized([this, &arr, &decode_element, len = *len]() -> std::expected<void, Error> {
+        if (len > _source.remaining()) {
+          // every element takes one byte at least
+          return std::unexpected(Error("invalid array length"));
+        }
+        // existing elements are decoded into, to reuse their storage
+        arr.resize(len);
+        for (VariableLength i = 0; i < len; ++i) {
+          if (auto r = decode_element(arr[i]); !r) {
+            r.error().at(i);
+            return r;
+          }
+        }
+        return {};
+      });
+    }
+  }
+
+  // jump over an encoded `T`
+  template <typename T>
+  auto _skip() -> std::expected<void, Error> {
+    if constexpr (std::is_arithmetic_v<T>) {
+      return _source.take(sizeof(T)) ? std::expected<void, Error>{}
+                                     : std::unexpected(Error(std::format("invalid bytes for {}", typeid(T).name())));
+    } else if constexpr (requires { typename T::traits_type; }) {
+      auto view = _decode_string();
+      return view ? std::expected<void, Error>{} : std::unexpected(std::move(view.error()));
+    } else if constexpr (requires { typename T::allocator_type; }) {
+      auto len = _decode_variable_len();
+      if (!len) {
+        return std::unexpected(std::move(len.error()));
+      }
+      if constexpr (_is_bulk<typename T::value_type>) {
+        return _source.take(size_t(*len) * sizeof(typename T::value_type))
+                   ? std::expected<void, Error>{}
+                   : std::unexpected(Error(std::format("insufficient bytes for {} array elements", *len)));
+      } else {
+        return _decode_sized([] { return std::expected<void, Error>{}; });
+      }
+    } else {
+      return _decode_sized([] { return std::expected<void, Error>{}; });
+    }
+  }
+};
+
+/**
+ * @brief A little endian binary codec which leads each model with an offset table of its fields, so that `View` reads
+ * any field in place without decoding the model
+ *
+ * @note Numbers and strings are laid out as `LittleEndianBinaryCodec`. A model is its u32 byte size, the u32 offset
+ * of each field from the model start, then the fields. An array of numbers is its length then the numbers, an array
+ * of other elements is its length, the u32 offset of each element from the array start, then the elements. Not wire
+ * compatible with other codecs. Decode destination object may come into invalid status if decode failed
+ */
+class TableBinaryCodec : public _impl::BytesCodec<std::endian::little> {
+  using Base = _impl::BytesCodec<std::endian::little>;
+
+ public:
+  // offset tables are patched in once the values they point to are written
+  inline static constexpr bool back_patches = true;
+
+  using Base::decode;
+  using Base::encode;
+  using Base::size_of;
+
+  // the leading tag of strings and arrays
+  inline static constexpr char length_tag = _variable_length_tag;
+
+  template <typename T, typename Alloc>
+  static size_t size_of(const std::vector<T, Alloc>& arr) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      return _variable_length_size + arr.size() * sizeof(T);
+    } else {
+      size_t size = _variable_length_size + arr.size() * sizeof(uint32_t);
+      for (const auto& v : arr) {
+        size += size_of(v);
+      }
+      return size;
+    }
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  static size_t size_of(const Model<Codec>& model) {
+    size_t size = (1 + Model<Codec>::field_count()) * sizeof(uint32_t);
+    Model<Codec>::visit_fields([&model, &size]<typename Field>(Field) {
+      size += size_of(model.*Field::pointer);
+      return true;
+    });
+    return size;
+  }
+
+  template <typename T, typename Alloc>
+  auto encode(const std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    size_t start = _sink.size();
+    auto len = _encode_varible_len(arr.size());
+    if (!len) {
+      return std::unexpected(std::move(len.error()));
+    }
+    if constexpr (std::is_same_v<T, bool>) {
+      // laid out as the other numbers, without a table, but a bit at a time
+      for (bool b : arr) {
+        encode(b);
+      }
+      return {};
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      // written as one block, sink overflow is reported by the caller
+      if (char* dst = _sink.claim(arr.size() * sizeof(T)); dst && !arr.empty()) {
+        std::memcpy(dst, arr.data(), arr.size() * sizeof(T));
+        _to_wire<T>(dst, arr.size());
+      }
+      return {};
+    }
+    size_t table = _claim_table(*len);
+    for (VariableLength i = 0; i < *len; ++i) {
+      if (auto r = _set_offset(table + i * sizeof(uint32_t), start); !r) {
+        return r;
+      }
+      if (auto r = encode(arr[i]); !r) {
+        r.error().at(i);
+        return r;
+      }
+    }
+    return {};
+  }
+
+  template <typename T, typename Alloc>
+  auto decode(std::vector<T, Alloc>& arr) -> std::expected<void, Error> {
+    const char* start = _source.cursor();
+    auto len = _decode_variable_len();
+    if (!len) {
+      return std::unexpected(std::move(len.error()));
+    }
+    _rebind(arr);
+    if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+      const char* src = _source.take(size_t(*len) * sizeof(T));
+      if (!src) {
+        return std::unexpected(Error(std::format("insufficient bytes for {} array elements", *len)));
+      }
+      arr.resize(*len);
+      if (!arr.empty()) {
+        std::memcpy(arr.data(), src, arr.size() * sizeof(T));
+      }
+      _to_wire<T>(reinterpret_cast<char*>(arr.data()), arr.size());
+      return {};
+    }
+    const char* table = nullptr;
+    if constexpr (!std::is_arithmetic_v<T>) {
+      if (!(table = _source.take(size_t(*len) * sizeof(uint32_t)))) {
+        return std::unexpected(Error("invalid array length"));
+      }
+    } else if (*len > _source.remaining()) {
+      return std::unexpected(Error("invalid array length"));
+    }
+    // existing elements are decoded into, to reuse their storage
+    arr.resize(*len);
+    for (VariableLength i = 0; i < *len; ++i) {
+      auto r = table ? _check_offset(table + i * sizeof(uint32_t), start) : std::expected<void, Error>{};
+      if (r) {
+        r = decode(arr[i]);
+      }
+      if (!r) {
+        r.error().at(i);
+        return r;
+      }
+    }
+    return {};
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  auto encode(const Model<Codec>& model) -> std::expected<void, Error> {
+    size_t start = _sink.size();
+    _claim_table(1 + Model<Codec>::field_count());
+    std::expected<void, Error> res;
+    Model<Codec>::visit_fields([this, &model, &res, start]<typename Field>(Field) {
+      res = _set_offset(start + (1 + Field::index) * sizeof(uint32_t), start);
+      if (res) {
+        res = encode(model.*Field::pointer);
+      }
+      return res || (res.error().at(Field::name), false);
+    });
+    if (!res) {
+      return res;
+    }
+    size_t size = _sink.size() - start;
+    if (size > UINT32_MAX) {
+      return std::unexpected(Error("model only support a maximum 4G bytes"));
+    }
+    auto wire = _to_wire(static_cast<uint32_t>(size));
+    _sink.patch(start, &wire, sizeof(wire));
+    return {};
+  }
+
+  template <template <typename> typename Model, typename Codec>
+    requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+  auto decode(Model<Codec>& model) -> std::expected<void, Error> {
+    const char* start = _source.cursor();
+    uint32_t size;
+    if (auto r = decode(size); !r) {
+      return r;
+    }
+    const char* table = _source.take(Model<Codec>::field_count() * sizeof(uint32_t));
+    if (!table || size > size_t(_source.end() - start)) {
+      return std::unexpected(Error("insufficient bytes for model"));
+    }
+    std::expected<void, Error> res;
+    Model<Codec>::visit_fields([this, &model, &res, start, table]<typename Field>(Field) {
+      res = _check_offset(table + Field::index * sizeof(uint32_t), start);
+      if (res) {
+        res = decode(model.*Field::pointer);
+      }
+      return res || (res.error().at(Field::name), false);
+    });
+    if (res && _source.cursor() > start + size) {
+      return std::unexpected(Error("model overruns its size"));
+    }
+    return res ? (_source.seek(start + size), res) : res;
+  }
+
+ private:
+  // write a zeroed table of `n` u32 entries, and return its offset in the sink
+  size_t _claim_table(size_t n) {
+    size_t at = _sink.size();
+    if (char* table = _sink.claim(n * sizeof(uint32_t)); table) {
+      std::memset(table, 0, n * sizeof(uint32_t));
+    }
+    return at;
+  }
+
+  // set the table entry at `slot` to the offset of the next written byte from `start`
+  auto _set_offset(size_t slot, size_t start) -> std::expected<void, Error> {
+    size_t offset = _sink.size() - start;
+    if (offset > UINT32_MAX) {
+      return std::unexpected(Error("offset only support a maximum 4G bytes"));
+    }
+    auto wire = _to_wire(static_cast<uint32_t>(offset));
+    _sink.patch(slot, &wire, sizeof(wire));
+    return {};
+  }
+
+  // values are decoded in the order they are written, the table entry at `slot` must point to the cursor
+  auto _check_offset(const char* slot, const char* start) -> std::expected<void, Error> {
+    uint32_t offset;
+    std::memcpy(&offset, slot, sizeof(offset));
+    if (start + _to_wire(offset) != _source.cursor()) {
+      return std::unexpected(Error("unexpected offset in table"));
+    }
+    return {};
   }
 };
 
-}  // namespace proto
\ No newline at end of file
+}  // namespace proto
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "proto.h"
+
+namespace proto {
+
+/**
+ * @brief Decode a `Model` encoded by `BinaryCodec` or `LittleEndianBinaryCodec` from chunks of bytes as they arrive,
+ * e.g. partial network reads. Where the decoding stands, down the nested models and arrays, is kept between chunks, so
+ * that each byte is read once: strings and arrays of numbers are copied in as their bytes come, and only a number or
+ * a length split between two chunks is put together aside
+ *
+ * @note The model is decoded into in place, its strings and arrays reuse their storage and elements, and it may be in
+ * invalid status till `feed()` returns `done`. Nested models and arrays point into it, so a decoder is not copyable
+ */
+template <typename Model, typename Codec = BinaryCodec>
+  requires std::is_same_v<Codec, BasicBinaryCodec<Codec::order>>
+class IncrementalDecoder {
+ public:
+  using Error = typename Codec::Error;
+
+  enum class Status {
+    need_more,
+    done,
+    error,
+  };
+
+  IncrementalDecoder() { reset(); }
+
+  IncrementalDecoder(const IncrementalDecoder&) = delete;
+
+  IncrementalDecoder& operator=(const IncrementalDecoder&) = delete;
+
+  /**
+   * @brief Decode the bytes of `chunk` on from where the previous chunk left off
+   *
+   * @note Bytes past the end of the model are not consumed, see `consumed()`. Once `done` or `error`, feeding returns
+   * the same till `reset()`
+   */
+  auto feed(std::string_view chunk) -> Status {
+    if (_status != Status::need_more) {
+      return _status;
+    }
+    _begin = _cursor = chunk.data();
+    _end = _cursor + chunk.size();
+    while (!_frames.empty()) {
+      // a step pushing a frame returns at once, the reference is not used after the push
+      Frame& frame = _frames.back();
+      switch (frame.step(*this, frame)) {
+        case Step::done:
+          _frames.pop_back();
+          break;
+        case Step::pushed:
+          break;
+        case Step::need_more:
+          return Status::need_more;
+        case Step::failed:
+          _trace();
+          return _status = Status::error;
+      }
+    }
+    _consumed = _cursor - _begin;
+    return _status = Status::done;
+  }
+
+  auto feed(std::span<const std::byte> chunk) -> Status {
+    return feed(std::string_view(reinterpret_cast<const char*>(chunk.data()), chunk.size()));
+  }
+
+  /**
+   * @brief Bytes of the last chunk taken by the model once `done`, the next message begins right after them
+   */
+  size_t consumed() const { return _consumed; }
+
+  auto model() -> Model& { return _model; }
+
+  auto model() const -> const Model& { return _model; }
+
+  /**
+   * @note Valid once `feed()` returns `error`
+   */
+  auto error() const -> const Error& { return _error; }
+
+  /**
+   * @brief Start over for the next message, which is decoded into the same model, e.g. after it is read or moved out
+   */
+  void reset() {
+    _frames.clear();
+    _push(&_model);
+    _carried = 0;
+    _consumed = 0;
+    _status = Status::need_more;
+    _error = {};
+  }
+
+ private:
+  enum class Step {
+    done,
+    // a frame of a nested value is pushed, which goes first
+    pushed,
+    need_more,
+    failed,
+  };
+
+  struct Frame {
+    Step (*step)(IncrementalDecoder&, Frame&);
+    void* object;
+    // field names of a model, to tell the path of a failure, null for others
+    const std::string_view* names = nullptr;
+    // the next field or element, or bytes of a string or an array of numbers copied so far
+    size_t index = 0;
+    // length of a string or an array, unknown till its header is read
+    size_t count = _impl::unknown_count;
+  };
+
+  template <typename T>
+  Step _push(T* object) {
+    Frame frame = {.step = &IncrementalDecoder::_step<T>, .object = object};
+    if constexpr (_impl::is_model<T>) {
+      frame.names = _impl::FieldNames<T>::names.data();
+    }
+    _frames.push_back(frame);
+    return Step::pushed;
+  }
+
+  template <typename T>
+  static Step _step(IncrementalDecoder& self, Frame& frame) {
+    T& value = *static_cast<T*>(frame.object);
+    if constexpr (_impl::is_model<T>) {
+      return self._decode_model(value, frame);
+    } else if constexpr (_impl::is_string<T>) {
+      return self._decode_string(value, frame);
+    } else {
+      static_assert(_impl::is_vector<T>, "unsupported field type");
+      return self._decode_array(value, frame);
+    }
+  }
+
+  template <typename T>
+  Step _decode_model(T& model, Frame& frame) {
+    using Runs = _impl::ArithmeticRuns<T>;
+    Step step = Step::done;
+    // numbers and strings whole in the chunk are read in place, others get a frame of their own
+    T::visit_fields([this, &model, &frame, &step]<typename Field>(Field) {
+      if (Field::index < frame.index) {
+        return true;
+      }
+      if constexpr (std::is_arithmetic_v<typename Field::Type>) {
+        if constexpr (Runs::lengths[Field::index] > 1) {
+          if (_carried == 0 && size_t(_end - _cursor) >= Runs::bytes[Field::index]) {
+            _decode_run<Field::index, Runs::lengths[Field::index]>(model);
+            frame.index = Field::index + Runs::lengths[Field::index];
+            return true;
+          }
+        }
+        if (!_decode(model.*Field::pointer)) {
+          step = Step::need_more;
+          return false;
+        }
+        frame.index = Field::index + 1;
+        return true;
+      } else {
+        frame.index = Field::index + 1;
+        if constexpr (_impl::is_string<typename Field::Type>) {
+          if (_decode_whole(model.*Field::pointer)) {
+            return true;
+          }
+        }
+        step = _push(&(model.*Field::pointer));
+        return false;
+      }
+    });
+    return step;
+  }
+
+  // the run of `N` arithmetic fields from the `I`-th, which is whole in the chunk
+  template <size_t I, size_t N, typename T>
+  void _decode_run(T& model) {
+    using Runs = _impl::ArithmeticRuns<T>;
+    const char* bytes = _cursor;
+    _cursor += Runs::bytes[I];
+    T::visit_fields([bytes, &model]<typename Field>(Field) {
+      if constexpr (Field::index >= I && Field::index < I + N) {
+        _load(bytes + Runs::offsets[Field::index], model.*Field::pointer);
+      }
+      return true;
+    });
+  }
+
+  // a string whole in the chunk, which takes no frame, false if it is not
+  template <typename Alloc>
+  bool _decode_whole(_impl::String<Alloc>& str) {
+    constexpr size_t header = 1 + sizeof(typename Codec::VariableLength);
+    if (size_t(_end - _cursor) < header || *_cursor != Codec::length_tag) {
+      return false;
+    }
+    typename Codec::VariableLength len;
+    _load(_cursor + 1, len);
+    if (len > size_t(_end - _cursor) - header) {
+      return false;
+    }
+    str.assign(_cursor + header, len);
+    _cursor += header + len;
+    return true;
+  }
+
+  template <typename Alloc>
+  Step _decode_string(_impl::String<Alloc>& str, Frame& frame) {
+    if (frame.count == _impl::unknown_count) {
+      if (Step step = _decode_length(frame, "string start: expect variable length tag"); step != Step::done) {
+        return step;
+      }
+      str.clear();
+    }
+    size_t n = std::min(frame.count - frame.index, size_t(_end - _cursor));
+    if (n > 0) {
+      str.append(_cursor, n);
+      _cursor += n;
+      frame.index += n;
+    }
+    return frame.index == frame.count ? Step::done : Step::need_more;
+  }
+
+  template <typename T, typename Alloc>
+  Step _decode_array(std::vector<T, Alloc>& arr, Frame& frame) {
+    if (frame.count == _impl::unknown_count) {
+      if (Step step = _decode_length(frame, "expect variable length tag"); step != Step::done) {
+        return step;
+      }
+    }
+    if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+      // the bytes are copied as they come, grown with them rather than to a length yet to be proven by the input
+      size_t bytes = frame.count * sizeof(T);
+      size_t n = std::min(bytes - frame.index, size_t(_end - _cursor));
+      if (n > 0) {
+        arr.resize((frame.index + n + sizeof(T) - 1) / sizeof(T));
+        std::memcpy(reinterpret_cast<char*>(arr.data()) + frame.index, _cursor, n);
+        _cursor += n;
+        frame.index += n;
+      }
+      if (frame.index < bytes) {
+        return Step::need_more;
+      }
+      arr.resize(frame.count);
+      if constexpr (std::endian::native != Codec::order && sizeof(T) > 1) {
+        _impl::simd::byteswap(reinterpret_cast<char*>(arr.data()), arr.size(), sizeof(T));
+      }
+      return Step::done;
+    } else {
+      // existing elements are decoded into, to reuse their storage
+      for (; frame.index < frame.count; ++frame.index) {
+        if (frame.index == arr.size()) {
+          arr.emplace_back();
+        }
+        if constexpr (std::is_arithmetic_v<T>) {
+          T value;
+          if (!_decode(value)) {
+            return Step::need_more;
+          }
+          arr[frame.index] = value;
+        } else if constexpr (_impl::is_string<T>) {
+          if (!_decode_whole(arr[frame.index])) {
+            return _push(&arr[frame.index++]);
+          }
+        } else {
+          return _push(&arr[frame.index++]);
+        }
+      }
+      arr.resize(frame.count);
+      return Step::done;
+    }
+  }
+
+  // the tag and length of a string or an array, into `frame.count`
+  Step _decode_length(Frame& frame, const char* mismatch) {
+    const char* header = _take(1 + sizeof(typename Codec::VariableLength));
+    if (!header) {
+      return Step::need_more;
+    }
+    if (*header != Codec::length_tag) {
+      _error = Error(mismatch);
+      return Step::failed;
+    }
+    typename Codec::VariableLength len;
+    _load(header + 1, len);
+    frame.count = len;
+    return Step::done;
+  }
+
+  template <typename T>
+  bool _decode(T& num) {
+    const char* bytes = _take(sizeof(T));
+    return bytes && (_load(bytes, num), true);
+  }
+
+  template <typename T>
+  static void _load(const char* bytes, T& num) {
+    std::memcpy(&num, bytes, sizeof(T));
+    if constexpr (std::endian::native != Codec::order) {
+      num = _impl::simd::byteswap(num);
+    }
+  }
+
+  // `n` bytes in the chunk, or put together from the previous chunks, which stay valid till the next call
+  const char* _take(size_t n) {
+    if (_carried == 0 && size_t(_end - _cursor) >= n) {
+      const char* bytes = _cursor;
+      _cursor += n;
+      return bytes;
+    }
+    size_t m = std::min(n - _carried, size_t(_end - _cursor));
+    if (m > 0) {
+      std::memcpy(_carry.data() + _carried, _cursor, m);
+      _cursor += m;
+      _carried += m;
+    }
+    if (_carried < n) {
+      return nullptr;
+    }
+    _carried = 0;
+    return _carry.data();
+  }
+
+  // prepend the fields and array indexes of the frames, from the innermost one
+  void _trace() {
+    for (size_t i = _frames.size() - 1; i-- > 0;) {
+      Frame& frame = _frames[i];
+      frame.names ? _error.at(frame.names[frame.index - 1]) : _error.at(frame.index - 1);
+    }
+  }
+
+  Model _model;
+  std::vector<Frame> _frames;
+  const char* _begin = nullptr;
+  const char* _cursor = nullptr;
+  const char* _end = nullptr;
+  // bytes of a number or a length split between chunks
+  std::array<char, 16> _carry;
+  size_t _carried = 0;
+  size_t _consumed = 0;
+  Status _status = Status::need_more;
+  Error _error;
+};
+
+}  // namespace proto
@@ -1,10 +1,16 @@
 #pragma once
 
-#include <map>
-#include <memory>
+#include <algorithm>
+#include <array>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "codec.h"
+#include "session.h"
+#include "stats.h"
 
 namespace proto {
 
@@ -19,124 +25,408 @@ struct MemberTrait<T Model::*> {
   using Class = Model;
 };
 
+// overload ranks which let `PROTO_FIELD` count the fields declared before it, the highest declared rank wins
+template <size_t N>
+struct Rank : Rank<N - 1> {};
+
+template <>
+struct Rank<0> {};
+
+inline constexpr size_t max_fields = 256;
+
+template <size_t I>
+struct FieldSlot {};
+
+template <size_t N>
+struct FieldName {
+  constexpr FieldName(const char (&str)[N]) { std::copy_n(str, N, value); }
+
+  char value[N];
+};
+
+/**
+ * @brief Compile-time descriptor of the `I`-th codable field of a model
+ */
+template <size_t I, auto member, FieldName field_name>
+struct Field {
+  using Type = typename MemberTrait<decltype(member)>::Field;
+  using Class = typename MemberTrait<decltype(member)>::Class;
+
+  inline static constexpr size_t index = I;
+  inline static constexpr auto pointer = member;
+  inline static constexpr std::string_view name = {field_name.value, sizeof(field_name.value) - 1};
+};
+
+template <typename Model, size_t I>
+using FieldAt = decltype(Model::_proto_field(FieldSlot<I>{}));
+
+// field names of a model in declaration order, and sorted with their indexes
+template <typename Model>
+struct FieldNames {
+  inline static constexpr auto names = [] {
+    std::array<std::string_view, Model::field_count()> names;
+    Model::visit_fields([&names]<typename Field>(Field) { return (names[Field::index] = Field::name, true); });
+    return names;
+  }();
+
+  inline static constexpr auto sorted = [] {
+    std::array<std::pair<std::string_view, size_t>, Model::field_count()> sorted;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+      sorted[i] = {names[i], i};
+    }
+    std::ranges::sort(sorted);
+    return sorted;
+  }();
+};
+
 }  // namespace _impl
 
 template <typename Model>
 class BaseModel;
 
+namespace _impl {
+
+template <typename T>
+inline constexpr bool is_vector = false;
+
+template <typename T, typename Alloc>
+inline constexpr bool is_vector<std::vector<T, Alloc>> = true;
+
+template <typename T>
+inline constexpr bool is_string = false;
+
+template <typename Alloc>
+inline constexpr bool is_string<String<Alloc>> = true;
+
+template <typename T>
+inline constexpr bool is_model = false;
+
+template <template <typename> typename Model, typename Codec>
+  requires std::is_base_of_v<BaseModel<Model<Codec>>, Model<Codec>>
+inline constexpr bool is_model<Model<Codec>> = true;
+
+}  // namespace _impl
+
 /**
  * @param Codec Default codec for this model class
+ *
+ * @note Codable fields are declared by `PROTO_FIELD`, which records them in a compile-time field table
  */
 template <template <typename> typename Model, Codeable Codec>
 class BaseModel<Model<Codec>> {
  public:
-  struct BaseField {
-    BaseField(const char* name) : _name(name) {}
-
-    const char* name() const { return _name; }
-
-    virtual size_t offset() const = 0;
-
-    virtual auto dump(const void* model, Codec& codec) const -> std::expected<void, typename Codec::Error> = 0;
-
-    virtual auto load(void* model, Codec& codec) const -> std::expected<void, typename Codec::Error> = 0;
-
-   private:
-    const char* _name;
-  };
+  constexpr static size_t field_count() {
+    return decltype(Model<Codec>::_proto_field_count(_impl::Rank<_impl::max_fields>{}))::value;
+  }
 
-  template <typename T>
-  class TypeField : public BaseField {
-   public:
-    TypeField(const char* name, T Model<Codec>::* offset) : BaseField(name), _offset(offset) {};
+  /**
+   * @brief Call `func` with the `_impl::Field` descriptor of each codable field in declaration order, until it
+   * returns false
+   *
+   * @return Whether all calls return true
+   */
+  template <typename Func>
+  constexpr static bool visit_fields(Func&& func) {
+    return [&func]<size_t... I>(std::index_sequence<I...>) {
+      return (func(_impl::FieldAt<Model<Codec>, I>{}) && ...);
+    }(std::make_index_sequence<field_count()>{});
+  }
 
-    auto dump(const void* model, Codec& codec) const -> std::expected<void, typename Codec::Error> override {
-      return codec.encode(static_cast<const Model<Codec>*>(model)->*_offset);
+  /**
+   * @brief Index of the codable field named `name`, or `field_count()` if there is none
+   *
+   * @param hint Index of the field tried first, e.g. the one following the last found, which makes names arriving in
+   * declaration order cost one comparison. Others take a binary search over the sorted names
+   */
+  constexpr static size_t field_index(std::string_view name, size_t hint = 0) {
+    using Names = _impl::FieldNames<Model<Codec>>;
+    if (hint < field_count() && Names::names[hint] == name) {
+      return hint;
     }
+    auto it = std::ranges::lower_bound(Names::sorted, name, {}, &std::pair<std::string_view, size_t>::first);
+    return it != Names::sorted.end() && it->first == name ? it->second : field_count();
+  }
 
-    auto load(void* model, Codec& codec) const -> std::expected<void, typename Codec::Error> override {
-      return codec.decode(static_cast<Model<Codec>*>(model)->*_offset);
-    }
+  /**
+   * @brief A model of the `PROTO_FIELD` default values, which decoders reset the fields missing from their input to
+   */
+  static auto defaults() -> const Model<Codec>& {
+    static const Model<Codec> model;
+    return model;
+  }
 
-    size_t offset() const override { return *reinterpret_cast<const size_t*>(&_offset); }
+  // start point of the field counter, hidden as soon as the model declares its first field
+  static auto _proto_field_count(_impl::Rank<0>) -> std::integral_constant<size_t, 0>;
 
-   private:
-    T Model<Codec>::* _offset;
-  };
+  // field table of a model without fields, hidden as soon as the model declares its first field
+  template <size_t I>
+  static auto _proto_field(_impl::FieldSlot<I>) -> void;
 
-  constexpr static auto fields() -> const std::vector<const BaseField*>& {
-    static Model<Codec> _;
-    static auto fields = []() {
-      std::vector<const BaseField*> res;
-      for (auto& field : Model<Codec>::_fields) {
-        res.push_back(field.get());
-      }
-      std::sort(res.begin(), res.end(), [](const BaseField* a, const BaseField* b) { return a->offset() < b->offset(); });
-      return res;
-    }();
-    return fields;
+  /**
+   * @param data Input string is expected to be valid `Codec` format
+   */
+  static auto decode(std::string_view data) -> std::expected<Model<Codec>, typename Codec::Error> {
+    return decode_by<Codec>(data);
   }
 
   /**
-   * @brief Regist the field with given default value
+   * @note `data` is parsed in place without copy, bytes after the decoded model are ignored
    */
-  template <auto offset>
-  constexpr static auto codable_field(const char* name, typename _impl::MemberTrait<decltype(offset)>::Field value) {
-    static auto _ = (_regist<decltype(value)>(name, offset), 0);
-    return value;
+  template <Codeable CustomCodec>
+  static auto decode_by(std::string_view data) -> std::expected<Model<Codec>, typename CustomCodec::Error> {
+    size_t consumed;
+    return decode_by<CustomCodec>(data, consumed);
+  }
+
+  template <Codeable CustomCodec>
+  static auto decode_by(std::span<const std::byte> data) -> std::expected<Model<Codec>, typename CustomCodec::Error> {
+    return decode_by<CustomCodec>(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
   }
 
   /**
-   * @param data Input string is expected to be valid `Codec` format
+   * @brief Decode a model whose `std::pmr` strings and arrays, nested ones included, allocate from `resource`, e.g. a
+   * `std::pmr::monotonic_buffer_resource` arena which is released at once with all messages decoded into it
+   *
+   * @note Containers with other allocators are decoded as usual
    */
-  static auto decode(const std::string& data) -> std::expected<Model<Codec>, typename Codec::Error> {
-    return decode_by<Codec>(data);
+  template <Codeable CustomCodec>
+  static auto decode_by(std::string_view data, std::pmr::memory_resource* resource)
+      -> std::expected<Model<Codec>, typename CustomCodec::Error> {
+    Model<Codec> model;
+    if (auto r = decode_into<CustomCodec>(model, data, resource); r) {
+      return model;
+    } else {
+      return std::unexpected(r.error());
+    }
   }
 
+  /**
+   * @param consumed Set to the number of bytes the decoded model takes, if success. Which makes it possible to
+   * decode back-to-back models from one buffer
+   */
   template <Codeable CustomCodec>
-  static auto decode_by(const std::string& data) -> std::expected<Model<Codec>, typename CustomCodec::Error> {
+  static auto decode_by(std::string_view data, size_t& consumed)
+      -> std::expected<Model<Codec>, typename CustomCodec::Error> {
     Model<Codec> model;
-    CustomCodec codec;
-    codec.buffer() << data;
-    if (auto r = codec.decode(model); r) {
+    if (auto r = decode_into<CustomCodec>(model, data); r) {
+      consumed = *r;
       return model;
     } else {
       return std::unexpected(r.error());
     }
   }
 
+  /**
+   * @brief Decode into an existing model, nested strings and arrays reuse their storage and elements. Decoding the
+   * same kind of message into the same model repeatedly does no heap allocation in steady state
+   *
+   * @param resource If not null, `std::pmr` strings and arrays allocating from elsewhere are moved onto it first
+   * @note Nothing of the previous content is left, fields missing from a json object are reset to their defaults.
+   * `model` may come into invalid status if decode failed
+   * @return Number of consumed bytes, if success
+   */
+  template <Codeable CustomCodec = Codec>
+  static auto decode_into(Model<Codec>& model, std::string_view data, std::pmr::memory_resource* resource = nullptr)
+      -> std::expected<size_t, typename CustomCodec::Error> {
+    _impl::PooledSession<CustomCodec> session;
+    return _decode_with(session->codec(), model, data, resource);
+  }
+
+  /**
+   * @brief Same as above, with the codec of `session`, whose scratch space is kept for the next call
+   */
+  template <Codeable CustomCodec>
+  static auto decode_into(Model<Codec>& model, std::string_view data, CodecSession<CustomCodec>& session,
+                          std::pmr::memory_resource* resource = nullptr)
+      -> std::expected<size_t, typename CustomCodec::Error> {
+    session.reset();
+    return _decode_with(session.codec(), model, data, resource);
+  }
+
+  /**
+   * @brief Decode only the fields at `Paths`, e.g. `Path<&Message::code>` and `Path<&Message::data, &User::id>`, the
+   * others keep their default values and are jumped over without decoding
+   *
+   * @note Requires a codec which can jump over values, e.g. `SizedBinaryCodec`
+   */
+  template <Codeable CustomCodec, typename... Paths>
+    requires requires(CustomCodec c, Model<Codec>& m) { c.decode(m, _impl::Selection<Paths...>{}); }
+  static auto decode_fields(std::string_view data) -> std::expected<Model<Codec>, typename CustomCodec::Error> {
+    [[maybe_unused]] uint64_t begin = 0;
+    if constexpr (_impl::stats_enabled) {
+      begin = _impl::counters<Model<Codec>>().decode.start();
+    }
+    Model<Codec> model;
+    _impl::PooledSession<CustomCodec> session;
+    CustomCodec& codec = session->codec();
+    codec.source().reset(data);
+    auto r = codec.decode(model, _impl::Selection<Paths...>{});
+    if constexpr (_impl::stats_enabled) {
+      _impl::counters<Model<Codec>>().decode.record(r.has_value(), codec.source().consumed(), begin);
+    }
+    if (!r) {
+      return std::unexpected(r.error());
+    }
+    return model;
+  }
+
   /**
    * @return A valid `codec` format string, if success
    */
   auto encode() const -> std::expected<std::string, typename Codec::Error> { return encode_by<Codec>(); }
 
+  /**
+   * @brief Size of the `encode_by<CustomCodec>()` output without encoding, which is exact for binary codecs and a
+   * tight upper bound for text codecs
+   */
+  template <Codeable CustomCodec>
+  auto encoded_size() const -> size_t {
+    return CustomCodec::size_of(*static_cast<const Model<Codec>*>(this));
+  }
+
   template <Codeable CustomCodec>
   auto encode_by() const -> std::expected<std::string, typename CustomCodec::Error> {
-    CustomCodec codec;
-    if (auto r = codec.encode(*static_cast<const Model<Codec>*>(this)); r) {
-      return codec.buffer().str();
+    std::string out;
+    if (auto r = encode_by<CustomCodec>(out); r) {
+      return out;
     } else {
       return std::unexpected(r.error());
     }
   }
 
+  /**
+   * @brief Append the encoded bytes to `out`, which is left unchanged if failed
+   *
+   * @return Number of appended bytes, if success
+   */
+  template <Codeable CustomCodec>
+  auto encode_by(std::string& out) const -> std::expected<size_t, typename CustomCodec::Error> {
+    _impl::PooledSession<CustomCodec> session;
+    CustomCodec& codec = session->codec();
+    codec.sink().append_to(out);
+    codec.sink().reserve(encoded_size<CustomCodec>());
+    return _encode_with(codec);
+  }
+
+  /**
+   * @brief Same as above with the codec of `session`, and `out` is not reserved for the model, e.g. a buffer which
+   * the caller reserves once for many models
+   */
+  template <Codeable CustomCodec>
+  auto encode_by(std::string& out, CodecSession<CustomCodec>& session) const
+      -> std::expected<size_t, typename CustomCodec::Error> {
+    session.reset();
+    session.codec().sink().append_to(out);
+    return _encode_with(session.codec());
+  }
+
+  /**
+   * @brief Write the encoded bytes into a caller provided buffer, fail if it is too small
+   *
+   * @return Number of written bytes, if success
+   */
+  template <Codeable CustomCodec>
+  auto encode_by(std::span<char> out) const -> std::expected<size_t, typename CustomCodec::Error> {
+    _impl::PooledSession<CustomCodec> session;
+    CustomCodec& codec = session->codec();
+    codec.sink().write_into(out);
+    return _encode_with(codec);
+  }
+
+  /**
+   * @brief Encode in chunks of at most `chunk_size` bytes, each passed to `flush` as soon as it is full, e.g. to send
+   * it, so that the memory taken is a chunk however large the model is. `flush` returns false to stop encoding
+   *
+   * @note The chunks flushed before a failure are a truncated message. A block of adjacent number fields written at
+   * once by a binary codec is not split, and a chunk of its own may be as long as it
+   * @return Number of encoded bytes, if success
+   */
+  template <Chunkable CustomCodec, typename Flush>
+    requires std::is_invocable_r_v<bool, Flush&, std::string_view>
+  auto encode_chunked(size_t chunk_size, Flush&& flush) const -> std::expected<size_t, typename CustomCodec::Error> {
+    _impl::PooledSession<CustomCodec> session;
+    CustomCodec& codec = session->codec();
+    bool stopped = false;
+    auto send = [&flush, &stopped](std::string_view chunk) { return !(stopped = !flush(chunk)); };
+    codec.sink().flush_to(chunk_size, send);
+    // the last chunk is flushed by `finish()`
+    auto r = _encode_with(codec);
+    codec.sink().reset();
+    if (stopped) {
+      return std::unexpected(typename CustomCodec::Error("output flush stopped"));
+    }
+    return r;
+  }
+
+  /**
+   * @brief Encode into the output buffer of `session`, which keeps its capacity, so that repeated calls do no
+   * allocation once it is large enough
+   *
+   * @return The encoded bytes, which are valid till the next use of `session`, if success
+   */
+  template <Codeable CustomCodec>
+  auto encode_by(CodecSession<CustomCodec>& session) const
+      -> std::expected<std::string_view, typename CustomCodec::Error> {
+    session.reset();
+    if (auto r = _encode_with(session.codec()); !r) {
+      return std::unexpected(r.error());
+    }
+    return session.codec().sink().view();
+  }
+
  protected:
-  template <typename T>
-  static void _regist(const char* name, T Model<Codec>::* offset) {
-    BaseModel::_fields.emplace_back(std::make_unique<TypeField<T>>(name, offset));
+  template <Codeable CustomCodec>
+  static auto _decode_with(CustomCodec& codec, Model<Codec>& model, std::string_view data,
+                           std::pmr::memory_resource* resource) -> std::expected<size_t, typename CustomCodec::Error> {
+    [[maybe_unused]] uint64_t begin = 0;
+    if constexpr (_impl::stats_enabled) {
+      begin = _impl::counters<Model<Codec>>().decode.start();
+    }
+    codec.set_resource(resource);
+    codec.source().reset(data);
+    auto r = codec.decode(model);
+    if constexpr (_impl::stats_enabled) {
+      _impl::counters<Model<Codec>>().decode.record(r.has_value(), codec.source().consumed(), begin);
+    }
+    if (!r) {
+      return std::unexpected(r.error());
+    }
+    return codec.source().consumed();
   }
 
- private:
-  inline static std::vector<std::unique_ptr<BaseField>> _fields;
+  template <Codeable CustomCodec>
+  auto _encode_with(CustomCodec& codec) const -> std::expected<size_t, typename CustomCodec::Error> {
+    [[maybe_unused]] uint64_t begin = 0;
+    if constexpr (_impl::stats_enabled) {
+      begin = _impl::counters<Model<Codec>>().encode.start();
+    }
+    auto r = codec.encode(*static_cast<const Model<Codec>*>(this));
+    if (r && codec.sink().overflow()) {
+      r = std::unexpected(typename CustomCodec::Error("insufficient output buffer"));
+    }
+    if constexpr (_impl::stats_enabled) {
+      _impl::counters<Model<Codec>>().encode.record(r.has_value(), codec.sink().size(), begin);
+    }
+    if (!r) {
+      codec.sink().rollback();
+      return std::unexpected(r.error());
+    }
+    codec.sink().finish();
+    return codec.sink().size();
+  }
 };
 
 }  // namespace proto
 
-// #define PROTO_FIELD(type, name, ...) \
-//  public:                             \
-//   type name = __VA_ARGS__;           \
-//                                      \
-//  private:                            \
-//   inline static auto _dumpy_##name = (Model::template _regist<type>(#name, &Model::name), 0);
+// index of the field being declared, which is the number of fields declared before it
+#define _PROTO_FIELD_INDEX decltype(Model::_proto_field_count(proto::_impl::Rank<proto::_impl::max_fields>{}))::value
 
-#define PROTO_FIELD(type, name, ...) type name = Model::template codable_field<&Model::name>(#name, __VA_ARGS__);
+/**
+ * @brief Declare a codable field with the given default value, and record it into the model field table
+ */
+#define PROTO_FIELD(type, name, ...)                                                   \
+  type name = __VA_ARGS__;                                                             \
+  static auto _proto_field(proto::_impl::FieldSlot<_PROTO_FIELD_INDEX>)                \
+      -> proto::_impl::Field<_PROTO_FIELD_INDEX, &Model::name, #name>;                 \
+  static auto _proto_field_count(proto::_impl::Rank<_PROTO_FIELD_INDEX + 1>)           \
+      -> std::integral_constant<size_t, _PROTO_FIELD_INDEX + 1>;
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "proto.h"
+
+namespace proto {
+
+/**
+ * @brief Layout of a record file, all integers are little endian
+ *
+ * @note
+ *  - header: magic `PROTOREC`, version byte, flags byte, 6 reserved bytes
+ *  - records: u32 payload length, u32 CRC-32C of the payload if `checksum` is flagged, payload
+ *  - index, if `indexed` is flagged and the writer was closed: u64 record offset for each record, then a footer of u64
+ *    record count, u64 index offset, u32 CRC-32C of the offsets, 4 reserved bytes and magic `PROTOIDX`
+ */
+struct RecordFormat {
+  inline static constexpr std::string_view magic = "PROTOREC";
+  inline static constexpr std::string_view index_magic = "PROTOIDX";
+  inline static constexpr uint8_t version = 1;
+  inline static constexpr size_t header_size = 16;
+  inline static constexpr size_t footer_size = 32;
+
+  enum Flags : uint8_t {
+    checksum = 1,
+    indexed = 2,
+  };
+};
+
+/**
+ * @brief Append length prefixed records to a file
+ */
+class RecordWriter {
+ public:
+  using Error = _impl::Error;
+
+  struct Options {
+    // checksum each payload
+    bool checksum = true;
+    // write an offset index at `close()`, which lets readers seek to any record at once
+    bool index = true;
+  };
+
+  /**
+   * @brief Create or truncate the file at `path`, and write the file header
+   */
+  static auto create(const std::string& path, Options options) -> std::expected<RecordWriter, Error>;
+
+  static auto create(const std::string& path) -> std::expected<RecordWriter, Error> { return create(path, {}); }
+
+  RecordWriter(RecordWriter&& other) noexcept;
+
+  RecordWriter& operator=(RecordWriter&&) = delete;
+
+  /**
+   * @brief Close the file if it is still open, errors are dropped
+   */
+  ~RecordWriter();
+
+  /**
+   * @brief Append a record of `Codec` encoded `model`
+   */
+  template <Codeable Codec = BinaryCodec, typename Model>
+  auto write(const Model& model) -> std::expected<void, Error> {
+    // the frame header is patched in front of the encoded bytes, to write the record at once
+    _frame.assign(_frame_header_size(), '\0');
+    if (auto r = model.template encode_by<Codec>(_frame); !r) {
+      return std::unexpected(Error(std::move(r.error().what())));
+    }
+    return _write_frame();
+  }
+
+  /**
+   * @brief Append a record of raw payload bytes
+   */
+  auto write_bytes(std::string_view payload) -> std::expected<void, Error>;
+
+  /**
+   * @brief Records written so far
+   */
+  size_t size() const { return _offsets.size(); }
+
+  /**
+   * @brief Write the index if enabled, flush and close the file
+   */
+  auto close() -> std::expected<void, Error>;
+
+ private:
+  RecordWriter(std::FILE* file, Options options) : _file(file), _options(options) {}
+
+  std::FILE* _file;
+  Options _options;
+  uint64_t _offset = RecordFormat::header_size;
+  std::vector<uint64_t> _offsets;
+  std::string _frame;
+
+  size_t _frame_header_size() const { return _options.checksum ? 8 : 4; }
+
+  // fill in the frame header of `_frame`, and append it to the file
+  auto _write_frame() -> std::expected<void, Error>;
+};
+
+/**
+ * @brief Random access reader of a record file, which is mapped into memory or viewed in a caller buffer
+ *
+ * @note Records are located by the trailing index if there is one. Otherwise, e.g. the writer was not closed, frame
+ * headers are walked once at open, and a truncated last record is ignored
+ */
+class RecordReader {
+ public:
+  using Error = _impl::Error;
+
+  /**
+   * @brief Map the file at `path` read only
+   */
+  static auto open(const std::string& path) -> std::expected<RecordReader, Error>;
+
+  /**
+   * @brief Read records from `data`, which must outlive the reader
+   */
+  static auto view(std::string_view data) -> std::expected<RecordReader, Error>;
+
+  RecordReader(RecordReader&& other) noexcept;
+
+  RecordReader& operator=(RecordReader&&) = delete;
+
+  ~RecordReader();
+
+  size_t size() const { return _count; }
+
+  bool checksummed() const { return _flags & RecordFormat::checksum; }
+
+  /**
+   * @brief Payload of the `i`-th record, which is viewed in the file mapping. The checksum is verified if there is one
+   */
+  auto record(size_t i) const -> std::expected<std::string_view, Error>;
+
+  /**
+   * @brief Decode the `i`-th record in place, which fails if the model does not take the whole payload
+   */
+  template <typename Model, Codeable Codec = BinaryCodec>
+  auto read(size_t i) const -> std::expected<Model, Error> {
+    auto payload = record(i);
+    if (!payload) {
+      return std::unexpected(std::move(payload.error()));
+    }
+    size_t consumed = 0;
+    auto res = Model::template decode_by<Codec>(*payload, consumed);
+    if (!res) {
+      return std::unexpected(Error(std::format("record {}: {}", i, res.error().what())));
+    }
+    if (consumed != payload->size()) {
+      return std::unexpected(Error(std::format("record {}: {} trailing bytes", i, payload->size() - consumed)));
+    }
+    return res;
+  }
+
+ private:
+  RecordReader() = default;
+
+  std::string_view _data;
+  void* _map = nullptr;  // the mapping to unmap, if the reader maps the file
+  uint8_t _flags = 0;
+  size_t _count = 0;
+  // record offsets of the trailing index, or collected by walking frame headers if there is no index
+  const char* _index = nullptr;
+  std::vector<uint64_t> _offsets;
+
+  auto _load() -> std::expected<void, Error>;
+
+  uint64_t _offset(size_t i) const;
+};
+
+}  // namespace proto
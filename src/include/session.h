@@ -0,0 +1,99 @@
+#pragma once
+
+#include <optional>
+#include <type_traits>
+
+#include "codec.h"
+
+namespace proto {
+
+/**
+ * @brief A codec kept across calls. Its output buffer and scratch space keep their capacity through `reset()`, so a
+ * steady stream of messages does no codec setup and, once the buffers are large enough, no allocation in the codec
+ *
+ * @note Not thread safe. `encode_by()` and `decode_by()` without a session borrow one of the calling thread
+ */
+template <Codeable Codec>
+class CodecSession {
+ public:
+  auto codec() -> Codec& { return _codec; }
+
+  /**
+   * @brief Back to the state of a new codec, with the buffers kept
+   */
+  void reset() { _codec.reset(); }
+
+  /**
+   * @brief Free the output buffer and scratch space if they have grown beyond `capacity` bytes, e.g. after an
+   * exceptionally large message
+   */
+  void shrink(size_t capacity) {
+    if (_codec.capacity() > capacity) {
+      _codec.release();
+    }
+  }
+
+ private:
+  Codec _codec;
+};
+
+namespace _impl {
+
+/**
+ * @brief The `Codec` session of the calling thread, lent to one call at a time and reset on loan. A call nested in
+ * another one, e.g. from a custom codec, gets a session of its own
+ *
+ * @note Only codecs with `keeps_scratch` are pooled. The others hold nothing but the buffer cursors, which are
+ * cheaper to set up in place than to look up a thread local slot
+ */
+template <Codeable Codec>
+class PooledSession {
+ public:
+  PooledSession() {
+    if constexpr (!_pooled) {
+      _session = &_spare;
+    } else if (_slot.busy) {
+      _session = &_spare.emplace();
+    } else {
+      _slot.busy = true;
+      _session = &_slot.session;
+      _session->reset();
+    }
+  }
+
+  PooledSession(const PooledSession&) = delete;
+
+  PooledSession& operator=(const PooledSession&) = delete;
+
+  ~PooledSession() {
+    if (_pooled && _session == &_slot.session) {
+      _session->shrink(_max_kept);
+      _slot.busy = false;
+    }
+  }
+
+  auto operator*() -> CodecSession<Codec>& { return *_session; }
+
+  auto operator->() -> CodecSession<Codec>* { return _session; }
+
+ private:
+  inline static constexpr bool _pooled = requires { requires Codec::keeps_scratch; };
+
+  // output buffer and scratch space kept by a thread, larger ones are freed after use
+  inline static constexpr size_t _max_kept = 1 << 20;
+
+  struct Slot {
+    CodecSession<Codec> session;
+    bool busy = false;
+  };
+
+  inline static thread_local Slot _slot;
+
+  CodecSession<Codec>* _session;
+  // a session made in place is kept out of `std::optional`, which would keep its buffer cursors off registers
+  std::conditional_t<_pooled, std::optional<CodecSession<Codec>>, CodecSession<Codec>> _spare;
+};
+
+}  // namespace _impl
+
+}  // namespace proto
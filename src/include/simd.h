@@ -0,0 +1,62 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace proto::_impl::simd {
+
+/**
+ * @brief Reverse the byte order of a single arithmetic value
+ */
+template <typename T>
+  requires std::is_arithmetic_v<T>
+T byteswap(T value) {
+  if constexpr (sizeof(T) == 1) {
+    return value;
+  } else {
+    using U = std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>;
+    return std::bit_cast<T>(std::byteswap(std::bit_cast<U>(value)));
+  }
+}
+
+/**
+ * @brief Reverse the byte order of each of `count` consecutive `width` bytes values in place
+ *
+ * @param width One of 1, 2, 4 and 8
+ * @note Runs AVX2 or SSSE3 shuffles when the CPU supports them, and a scalar loop otherwise
+ */
+void byteswap(char* data, size_t count, size_t width);
+
+/**
+ * @brief Find where every JSON token starts: structural characters `{}[]:,` and opening quotes outside strings, and
+ * the first character of any other run outside strings, e.g. a number or a literal
+ *
+ * @param out Receives the offsets in ascending order, `size` entries at most
+ * @return Number of tokens
+ * @note Quotes escaped by an odd run of backslashes are string content. Classifies 64 bytes a time with AVX2 or SSSE3
+ * shuffles when the CPU supports them, and a scalar loop otherwise
+ */
+size_t json_tokens(const char* data, size_t size, uint32_t* out);
+
+/**
+ * @brief Offset of the first quote or backslash in `data`, or `size` if there is none
+ */
+size_t find_quote(const char* data, size_t size);
+
+/**
+ * @brief Offset of the first character a quoted string escapes: quote, backslash or control character, or `size` if
+ * there is none
+ */
+size_t find_escape(const char* data, size_t size);
+
+/**
+ * @brief CRC-32C (Castagnoli) of `data`, continued from the checksum `crc` of the preceding bytes
+ *
+ * @note Runs the SSE4.2 crc32 instruction when the CPU supports it, and a table lookup otherwise
+ */
+uint32_t crc32c(const char* data, size_t size, uint32_t crc = 0);
+
+}  // namespace proto::_impl::simd
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+/**
+ * @brief Per-model encode and decode counters, off by default. Build with `-DPROTO_STATS=1`, e.g. cmake `-DSTATS=1`, to
+ * turn them on. Off, they compile to nothing
+ *
+ * @note The flag is the same for the whole program, the library included, or inline model templates differ across
+ * translation units
+ */
+#ifndef PROTO_STATS
+#define PROTO_STATS 0
+#endif
+
+namespace proto {
+
+/**
+ * @brief Counters of one operation, encode or decode, of a model
+ */
+struct OpStats {
+  // elapsed time buckets, the i-th counts timed calls of [2^i, 2^(i+1)) nanoseconds
+  inline static constexpr size_t buckets = 32;
+
+  uint64_t calls = 0;
+  uint64_t failures = 0;
+  // produced by encode, consumed by decode, of succeeded calls
+  uint64_t bytes = 0;
+  // calls sampled for the elapsed time, which `nanoseconds` and `histogram` are of
+  uint64_t timed = 0;
+  uint64_t nanoseconds = 0;
+  std::array<uint64_t, buckets> histogram = {};
+};
+
+struct ModelStats {
+  // demangled type name of the model
+  std::string model;
+  OpStats encode = {};
+  OpStats decode = {};
+};
+
+/**
+ * @brief Counters of the models encoded or decoded so far by `BaseModel` methods, with nested models counted as part
+ * of the outermost one. Empty if the counters are off
+ *
+ * @note Calls still running on other threads may or may not be counted
+ */
+auto stats_snapshot() -> std::vector<ModelStats>;
+
+/**
+ * @brief Zero all counters, calls running meanwhile on other threads may survive it
+ */
+void stats_reset();
+
+namespace _impl {
+
+inline constexpr bool stats_enabled = PROTO_STATS;
+
+inline uint64_t stats_now() {
+  if constexpr (stats_enabled) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  } else {
+    return 0;
+  }
+}
+
+/**
+ * @brief Counters of an operation on one thread, written by that thread only, so that counting is a plain load and
+ * store with no locked instruction, and read by snapshots from any thread
+ */
+class OpCounters {
+ public:
+  // one of this many calls is timed, reading the clock twice costs more than encoding a small model
+  inline static constexpr uint64_t sample_every = 16;
+
+  /**
+   * @return Start time if this call is to be timed, otherwise 0
+   */
+  uint64_t start() const {
+    return _calls.load(std::memory_order_relaxed) % sample_every == 0 ? stats_now() : 0;
+  }
+
+  void record(bool ok, size_t bytes, uint64_t begin) {
+    _add(_calls, 1);
+    if (ok) {
+      _add(_bytes, bytes);
+    } else {
+      _add(_failures, 1);
+    }
+    if (begin != 0) {
+      _time(stats_now() - begin);
+    }
+  }
+
+  void add_to(OpStats& stats) const;
+
+  void reset();
+
+ private:
+  static void _add(std::atomic<uint64_t>& counter, uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  void _time(uint64_t elapsed);
+
+  std::atomic<uint64_t> _calls = 0;
+  std::atomic<uint64_t> _failures = 0;
+  std::atomic<uint64_t> _bytes = 0;
+  std::atomic<uint64_t> _timed = 0;
+  std::atomic<uint64_t> _nanoseconds = 0;
+  std::array<std::atomic<uint64_t>, OpStats::buckets> _histogram = {};
+};
+
+struct alignas(64) StatsShard {
+  OpCounters encode;
+  OpCounters decode;
+  // taken by a living thread, a released shard keeps its counts and is handed to the next thread
+  std::atomic<bool> owned = true;
+};
+
+class ModelCounters {
+ public:
+  // registered on construction, and never destroyed
+  explicit ModelCounters(const std::type_info& type);
+
+  /**
+   * @brief A released shard if any, otherwise a new one
+   */
+  auto acquire() -> StatsShard*;
+
+  auto snapshot() -> ModelStats;
+
+  void reset();
+
+ private:
+  const std::type_info& _type;
+  std::mutex _mutex;
+  std::deque<StatsShard> _shards;
+};
+
+struct ShardOwner {
+  ~ShardOwner() { shard->owned.store(false, std::memory_order_release); }
+
+  StatsShard* shard;
+};
+
+/**
+ * @brief Counters of `Model` on the calling thread
+ */
+template <typename Model>
+StatsShard& counters() {
+  static auto* model = new ModelCounters(typeid(Model));
+  thread_local ShardOwner owner = {model->acquire()};
+  return *owner.shard;
+}
+
+}  // namespace _impl
+
+}  // namespace proto
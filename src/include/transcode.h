@@ -0,0 +1,164 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "proto.h"
+
+namespace proto {
+
+/**
+ * @brief A codec which reads and writes the framing of arrays and models a piece at a time, e.g. `ReprCodec`,
+ * `JsonCodec`, `BinaryCodec` and `CompactBinaryCodec`. Codecs prefixing models with their sizes or offset tables,
+ * `SizedBinaryCodec` and `TableBinaryCodec`, are not
+ */
+template <typename Codec>
+concept Streamable = Codeable<Codec> && requires(Codec c, std::string_view s) {
+  c.decode(s);
+  { c.decode_array_begin() } -> std::convertible_to<std::expected<size_t, typename Codec::Error>>;
+  { c.decode_element(size_t(0)) } -> std::convertible_to<std::expected<bool, typename Codec::Error>>;
+  { c.decode_array_end() } -> std::convertible_to<std::expected<void, typename Codec::Error>>;
+  { c.encode_array_begin() } -> std::convertible_to<size_t>;
+  c.encode_element(size_t(0));
+  { c.encode_array_end(size_t(0), size_t(0)) } -> std::convertible_to<std::expected<void, typename Codec::Error>>;
+  { c.decode_model_begin() } -> std::convertible_to<bool>;
+  { c.decode_model_end() } -> std::convertible_to<bool>;
+  c.encode_model_begin();
+  c.encode_model_end();
+};
+
+namespace _impl {
+
+template <typename T, typename From, typename To>
+auto transcode_value(From& from, To& to) -> std::expected<void, typename To::Error>;
+
+template <typename Model, typename From, typename To>
+auto transcode_model(From& from, To& to) -> std::expected<void, typename To::Error> {
+  const char* begin = from.source().cursor();
+  size_t written = to.sink().size();
+  std::expected<void, typename To::Error> res;
+  // fields in the declaration order are streamed, anything else, e.g. json keys in another order or missing ones, is
+  // left to a whole model decode, which also tells the failure of an invalid input
+  bool streamed = from.decode_model_begin();
+  if (streamed) {
+    to.encode_model_begin();
+    Model::visit_fields([&from, &to, &res, &streamed]<typename Field>(Field) {
+      if (!(streamed = from.template decode_field<Field>())) {
+        return false;
+      }
+      to.template encode_field<Field>();
+      res = transcode_value<typename Field::Type>(from, to);
+      return res || (res.error().at(Field::name), false);
+    });
+    streamed = streamed && res && from.decode_model_end();
+  }
+  if (!res) {
+    return res;
+  }
+  if (streamed) {
+    to.encode_model_end();
+    return {};
+  }
+  from.source().rewind(begin);
+  to.sink().unclaim(to.sink().size() - written);
+  Model model;
+  if (auto r = from.decode(model); !r) {
+    return r;
+  }
+  return to.encode(model);
+}
+
+template <typename T, typename From, typename To>
+auto transcode_array(From& from, To& to) -> std::expected<void, typename To::Error> {
+  auto count = from.template decode_array_begin<T>();
+  if (!count) {
+    return std::unexpected(std::move(count.error()));
+  }
+  size_t mark = to.encode_array_begin();
+  size_t i = 0;
+  for (; i < *count; ++i) {
+    auto more = from.decode_element(i);
+    if (!more || !*more) {
+      if (!more) {
+        more.error().at(i);
+        return std::unexpected(std::move(more.error()));
+      }
+      break;
+    }
+    to.encode_element(i);
+    if (auto r = transcode_value<T>(from, to); !r) {
+      r.error().at(i);
+      return r;
+    }
+  }
+  if (auto r = from.decode_array_end(); !r) {
+    return r;
+  }
+  return to.encode_array_end(mark, i);
+}
+
+template <typename T, typename From, typename To>
+auto transcode_value(From& from, To& to) -> std::expected<void, typename To::Error> {
+  if constexpr (is_model<T>) {
+    return transcode_model<T>(from, to);
+  } else if constexpr (is_vector<T>) {
+    return transcode_array<typename T::value_type>(from, to);
+  } else if constexpr (is_string<T>) {
+    // viewed in the input, or in the scratch of a text codec till the next decode
+    std::string_view view;
+    if (auto r = from.decode(view); !r) {
+      return r;
+    }
+    return to.encode(view);
+  } else {
+    T value{};
+    if (auto r = from.decode(value); !r) {
+      return r;
+    }
+    return to.encode(value);
+  }
+}
+
+}  // namespace _impl
+
+/**
+ * @brief Convert a `Model` encoded by `From` into the `To` format and append it to `out`, without decoding a model.
+ * Fields are read and written one by one as the model field table lists them, numbers pass through a local and
+ * strings are viewed in `input`
+ *
+ * @note A json object whose keys are not in the declaration order is decoded into a model and encoded, as a whole,
+ * which gives the same output at the usual cost. `out` is left unchanged if failed
+ * @return Number of consumed bytes of `input`, if success
+ */
+template <Streamable From, Streamable To, typename Model>
+  requires std::is_same_v<typename From::Error, typename To::Error>
+auto transcode(std::string_view input, std::string& out) -> std::expected<size_t, typename To::Error> {
+  _impl::PooledSession<From> from_session;
+  _impl::PooledSession<To> to_session;
+  From& from = from_session->codec();
+  To& to = to_session->codec();
+  from.source().reset(input);
+  to.sink().append_to(out);
+  if (auto r = _impl::transcode_model<Model>(from, to); !r) {
+    to.sink().rollback();
+    return std::unexpected(std::move(r.error()));
+  }
+  to.sink().finish();
+  return from.source().consumed();
+}
+
+template <Streamable From, Streamable To, typename Model>
+  requires std::is_same_v<typename From::Error, typename To::Error>
+auto transcode(std::string_view input) -> std::expected<std::string, typename To::Error> {
+  std::string out;
+  // about right between formats alike, and a single growth away from text into binary
+  out.reserve(input.size());
+  if (auto r = transcode<From, To, Model>(input, out); !r) {
+    return std::unexpected(std::move(r.error()));
+  }
+  return out;
+}
+
+}  // namespace proto
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "proto.h"
+
+namespace proto {
+
+template <typename Model>
+class View;
+
+template <typename T>
+class ArrayView;
+
+namespace _impl {
+
+// what a `View` reads a field of type `T` as: numbers as they are, strings as `std::string_view`, arrays as
+// `ArrayView` and models as `View`
+template <typename T>
+struct ViewOf {
+  using Type = T;
+};
+
+template <typename Alloc>
+struct ViewOf<String<Alloc>> {
+  using Type = std::string_view;
+};
+
+template <typename T, typename Alloc>
+struct ViewOf<std::vector<T, Alloc>> {
+  using Type = ArrayView<T>;
+};
+
+template <typename T>
+  requires std::is_base_of_v<BaseModel<T>, T>
+struct ViewOf<T> {
+  using Type = View<T>;
+};
+
+template <typename T>
+T load(const char* p) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return *p != 0;
+  } else {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return std::endian::native != std::endian::little ? simd::byteswap(value) : value;
+  }
+}
+
+// read the `TableBinaryCodec` encoded `T` at `p`
+template <typename T>
+auto view_at(const char* p) -> typename ViewOf<T>::Type {
+  if constexpr (std::is_arithmetic_v<T>) {
+    return load<T>(p);
+  } else if constexpr (std::is_same_v<typename ViewOf<T>::Type, std::string_view>) {
+    return {p + 1 + sizeof(uint32_t), load<uint32_t>(p + 1)};
+  } else {
+    return typename ViewOf<T>::Type(p);
+  }
+}
+
+// index of the codable field `Member` of `Model`
+template <typename Model, auto Member>
+inline constexpr size_t field_of = [] {
+  size_t index = Model::field_count();
+  Model::visit_fields([&index]<typename Field>(Field) {
+    return same_member<Field::pointer, Member>() ? (index = Field::index, false) : true;
+  });
+  return index;
+}();
+
+/**
+ * @brief Check that the `TableBinaryCodec` encoded `T` at `p`, its nested values included, lies in `[p, end)`
+ */
+template <typename T>
+auto verify_at(const char* p, const char* end) -> std::expected<void, Error> {
+  size_t room = end - p;
+  if constexpr (std::is_arithmetic_v<T>) {
+    return room >= sizeof(T) ? std::expected<void, Error>{} : std::unexpected(Error("insufficient bytes for number"));
+  } else if constexpr (std::is_base_of_v<BaseModel<T>, T>) {
+    constexpr size_t table_size = (1 + T::field_count()) * sizeof(uint32_t);
+    if (room < table_size || load<uint32_t>(p) > room || load<uint32_t>(p) < table_size) {
+      return std::unexpected(Error("invalid model size"));
+    }
+    end = p + load<uint32_t>(p);
+    std::expected<void, Error> res;
+    T::visit_fields([p, end, &res]<typename Field>(Field) {
+      uint32_t offset = load<uint32_t>(p + (1 + Field::index) * sizeof(uint32_t));
+      res = offset >= table_size && offset < size_t(end - p) ? verify_at<typename Field::Type>(p + offset, end)
+                                                             : std::unexpected(Error("invalid field offset"));
+      return res || (res.error().at(Field::name), false);
+    });
+    return res;
+  } else {
+    if (room < 1 + sizeof(uint32_t) || *p != TableBinaryCodec::length_tag) {
+      return std::unexpected(Error("expect variable length tag"));
+    }
+    size_t len = load<uint32_t>(p + 1);
+    room -= 1 + sizeof(uint32_t);
+    if constexpr (std::is_same_v<typename ViewOf<T>::Type, std::string_view>) {
+      return len <= room ? std::expected<void, Error>{} : std::unexpected(Error("insufficient bytes for string"));
+    } else if constexpr (std::is_arithmetic_v<typename T::value_type>) {
+      return len <= room / sizeof(typename T::value_type)
+                 ? std::expected<void, Error>{}
+                 : std::unexpected(Error(std::format("insufficient bytes for {} array elements", len)));
+    } else {
+      if (len > room / sizeof(uint32_t)) {
+        return std::unexpected(Error("invalid array length"));
+      }
+      size_t table_end = 1 + (1 + len) * sizeof(uint32_t);
+      for (size_t i = 0; i < len; ++i) {
+        uint32_t offset = load<uint32_t>(p + 1 + (1 + i) * sizeof(uint32_t));
+        auto r = offset >= table_end && offset < size_t(end - p)
+                     ? verify_at<typename T::value_type>(p + offset, end)
+                     : std::unexpected(Error("invalid element offset"));
+        if (!r) {
+          r.error().at(i);
+          return r;
+        }
+      }
+      return {};
+    }
+  }
+}
+
+}  // namespace _impl
+
+/**
+ * @brief A read-only view of a model encoded by `TableBinaryCodec`, whose fields are read in place without decoding
+ * the model, e.g. `view.get<&User::name>()` is a `std::string_view` into the encoded bytes
+ *
+ * @note A view is a pointer to the bytes, which must outlive it and the views and strings read from it
+ */
+template <typename Model>
+class View {
+ public:
+  /**
+   * @brief View trusted bytes, e.g. encoded by this process, without any check
+   */
+  explicit View(const char* data) : _data(data) {}
+
+  /**
+   * @brief Check `data` once, the model and its nested values, and view it. Reads of a checked view stay in `data`
+   */
+  static auto of(std::string_view data) -> std::expected<View, _impl::Error> {
+    if (auto r = _impl::verify_at<Model>(data.data(), data.data() + data.size()); !r) {
+      return std::unexpected(std::move(r.error()));
+    }
+    return View(data.data());
+  }
+
+  /**
+   * @brief Read the field `Member`, as a number, `std::string_view`, `ArrayView` or `View` by its type
+   */
+  template <auto Member>
+  auto get() const {
+    constexpr size_t index = _impl::field_of<Model, Member>;
+    static_assert(index < Model::field_count(), "member is not a codable field of the model");
+    uint32_t offset = _impl::load<uint32_t>(_data + (1 + index) * sizeof(uint32_t));
+    return _impl::view_at<typename _impl::FieldAt<Model, index>::Type>(_data + offset);
+  }
+
+  /**
+   * @brief The encoded bytes of the model
+   */
+  std::string_view bytes() const { return {_data, _impl::load<uint32_t>(_data)}; }
+
+  /**
+   * @brief Decode the whole model out of the view
+   */
+  auto decode() const -> std::expected<Model, _impl::Error> {
+    return Model::template decode_by<TableBinaryCodec>(bytes());
+  }
+
+ private:
+  const char* _data;
+};
+
+/**
+ * @brief A read-only view of an array encoded by `TableBinaryCodec`, whose elements are read on access
+ */
+template <typename T>
+class ArrayView {
+ public:
+  using value_type = typename _impl::ViewOf<T>::Type;
+
+  class Iterator {
+   public:
+    using value_type = ArrayView::value_type;
+    using difference_type = std::ptrdiff_t;
+
+    Iterator() = default;
+
+    Iterator(const char* data, size_t i) : _data(data), _i(i) {}
+
+    value_type operator*() const { return ArrayView(_data)[_i]; }
+
+    Iterator& operator++() { return ++_i, *this; }
+
+    Iterator operator++(int) { return {_data, _i++}; }
+
+    bool operator==(const Iterator& other) const { return _i == other._i; }
+
+   private:
+    const char* _data = nullptr;
+    size_t _i = 0;
+  };
+
+  explicit ArrayView(const char* data) : _data(data) {}
+
+  size_t size() const { return _impl::load<uint32_t>(_data + 1); }
+
+  bool empty() const { return size() == 0; }
+
+  value_type operator[](size_t i) const {
+    const char* elements = _data + 1 + sizeof(uint32_t);
+    if constexpr (std::is_arithmetic_v<T>) {
+      return _impl::load<T>(elements + i * sizeof(T));
+    } else {
+      return _impl::view_at<T>(_data + _impl::load<uint32_t>(elements + i * sizeof(uint32_t)));
+    }
+  }
+
+  Iterator begin() const { return {_data, 0}; }
+
+  Iterator end() const { return {_data, size()}; }
+
+ private:
+  const char* _data;
+};
+
+}  // namespace proto
@@ -0,0 +1,236 @@
+#include "record.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cerrno>
+#include <cstring>
+
+#include "simd.h"
+
+namespace proto {
+
+namespace {
+
+template <typename T>
+void put_le(char* out, T value) {
+  if constexpr (std::endian::native == std::endian::big) {
+    value = _impl::simd::byteswap(value);
+  }
+  std::memcpy(out, &value, sizeof(T));
+}
+
+template <typename T>
+T get_le(const char* in) {
+  T value;
+  std::memcpy(&value, in, sizeof(T));
+  if constexpr (std::endian::native == std::endian::big) {
+    value = _impl::simd::byteswap(value);
+  }
+  return value;
+}
+
+_impl::Error io_error(std::string_view what, const std::string& path) {
+  return _impl::Error(std::format("{} {}: {}", what, path, std::strerror(errno)));
+}
+
+}  // namespace
+
+auto RecordWriter::create(const std::string& path, Options options) -> std::expected<RecordWriter, Error> {
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (!file) {
+    return std::unexpected(io_error("failed to create", path));
+  }
+  char header[RecordFormat::header_size] = {};
+  RecordFormat::magic.copy(header, RecordFormat::magic.size());
+  header[8] = RecordFormat::version;
+  header[9] = (options.checksum ? RecordFormat::checksum : 0) | (options.index ? RecordFormat::indexed : 0);
+  if (std::fwrite(header, sizeof(header), 1, file) != 1) {
+    auto error = io_error("failed to write", path);
+    std::fclose(file);
+    return std::unexpected(std::move(error));
+  }
+  return RecordWriter(file, options);
+}
+
+RecordWriter::RecordWriter(RecordWriter&& other) noexcept
+    : _file(std::exchange(other._file, nullptr)),
+      _options(other._options),
+      _offset(other._offset),
+      _offsets(std::move(other._offsets)),
+      _frame(std::move(other._frame)) {}
+
+RecordWriter::~RecordWriter() { (void)close(); }
+
+auto RecordWriter::write_bytes(std::string_view payload) -> std::expected<void, Error> {
+  _frame.assign(_frame_header_size(), '\0');
+  _frame += payload;
+  return _write_frame();
+}
+
+auto RecordWriter::_write_frame() -> std::expected<void, Error> {
+  if (!_file) {
+    return std::unexpected(Error("record writer is closed"));
+  }
+  size_t size = _frame.size() - _frame_header_size();
+  if (size > UINT32_MAX) {
+    return std::unexpected(Error(std::format("record of {} bytes exceeds the 4 GiB limit", size)));
+  }
+  put_le(_frame.data(), static_cast<uint32_t>(size));
+  if (_options.checksum) {
+    put_le(_frame.data() + 4, _impl::simd::crc32c(_frame.data() + 8, size));
+  }
+  if (std::fwrite(_frame.data(), _frame.size(), 1, _file) != 1) {
+    return std::unexpected(Error(std::format("failed to write record: {}", std::strerror(errno))));
+  }
+  _offsets.push_back(_offset);
+  _offset += _frame.size();
+  return {};
+}
+
+auto RecordWriter::close() -> std::expected<void, Error> {
+  if (!_file) {
+    return {};
+  }
+  bool ok = true;
+  if (_options.index) {
+    _frame.resize(_offsets.size() * 8 + RecordFormat::footer_size);
+    char* out = _frame.data();
+    for (uint64_t offset : _offsets) {
+      put_le(out, offset);
+      out += 8;
+    }
+    put_le(out, static_cast<uint64_t>(_offsets.size()));
+    put_le(out + 8, _offset);
+    put_le(out + 16, _impl::simd::crc32c(_frame.data(), _offsets.size() * 8));
+    put_le(out + 20, uint32_t(0));
+    RecordFormat::index_magic.copy(out + 24, RecordFormat::index_magic.size());
+    ok = std::fwrite(_frame.data(), _frame.size(), 1, _file) == 1;
+  }
+  ok = std::fclose(std::exchange(_file, nullptr)) == 0 && ok;
+  if (!ok) {
+    return std::unexpected(Error(std::format("failed to close record file: {}", std::strerror(errno))));
+  }
+  return {};
+}
+
+auto RecordReader::open(const std::string& path) -> std::expected<RecordReader, Error> {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return std::unexpected(io_error("failed to open", path));
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    auto error = io_error("failed to stat", path);
+    ::close(fd);
+    return std::unexpected(std::move(error));
+  }
+  RecordReader reader;
+  if (st.st_size > 0) {
+    void* map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      auto error = io_error("failed to map", path);
+      ::close(fd);
+      return std::unexpected(std::move(error));
+    }
+    reader._map = map;
+    reader._data = {static_cast<const char*>(map), static_cast<size_t>(st.st_size)};
+  }
+  ::close(fd);
+  if (auto r = reader._load(); !r) {
+    return std::unexpected(Error(std::format("{}: {}", path, r.error().what())));
+  }
+  return reader;
+}
+
+auto RecordReader::view(std::string_view data) -> std::expected<RecordReader, Error> {
+  RecordReader reader;
+  reader._data = data;
+  if (auto r = reader._load(); !r) {
+    return std::unexpected(std::move(r.error()));
+  }
+  return reader;
+}
+
+RecordReader::RecordReader(RecordReader&& other) noexcept
+    : _data(std::exchange(other._data, {})),
+      _map(std::exchange(other._map, nullptr)),
+      _flags(other._flags),
+      _count(std::exchange(other._count, 0)),
+      _index(std::exchange(other._index, nullptr)),
+      _offsets(std::move(other._offsets)) {}
+
+RecordReader::~RecordReader() {
+  if (_map) {
+    ::munmap(_map, _data.size());
+  }
+}
+
+auto RecordReader::_load() -> std::expected<void, Error> {
+  if (_data.size() < RecordFormat::header_size || !_data.starts_with(RecordFormat::magic)) {
+    return std::unexpected(Error("not a record file"));
+  }
+  if (static_cast<uint8_t>(_data[8]) != RecordFormat::version) {
+    return std::unexpected(Error(std::format("unsupported record file version {}", static_cast<int>(_data[8]))));
+  }
+  _flags = static_cast<uint8_t>(_data[9]);
+
+  if ((_flags & RecordFormat::indexed) && _data.size() >= RecordFormat::header_size + RecordFormat::footer_size &&
+      _data.ends_with(RecordFormat::index_magic)) {
+    const char* footer = _data.data() + _data.size() - RecordFormat::footer_size;
+    auto count = get_le<uint64_t>(footer);
+    auto offset = get_le<uint64_t>(footer + 8);
+    size_t capacity = (_data.size() - RecordFormat::header_size - RecordFormat::footer_size) / 8;
+    if (offset < RecordFormat::header_size || offset > _data.size() || count > capacity ||
+        offset + count * 8 + RecordFormat::footer_size != _data.size()) {
+      return std::unexpected(Error("invalid record index"));
+    }
+    if (_impl::simd::crc32c(_data.data() + offset, count * 8) != get_le<uint32_t>(footer + 16)) {
+      return std::unexpected(Error("record index checksum mismatch"));
+    }
+    _index = _data.data() + offset;
+    _count = count;
+    return {};
+  }
+
+  // no index, walk the frames and drop a truncated tail, e.g. of a writer which is still appending or crashed
+  size_t frame_header = _flags & RecordFormat::checksum ? 8 : 4;
+  for (size_t pos = RecordFormat::header_size; _data.size() - pos >= frame_header;) {
+    size_t size = get_le<uint32_t>(_data.data() + pos);
+    if (_data.size() - pos - frame_header < size) {
+      break;
+    }
+    _offsets.push_back(pos);
+    pos += frame_header + size;
+  }
+  _count = _offsets.size();
+  return {};
+}
+
+uint64_t RecordReader::_offset(size_t i) const { return _index ? get_le<uint64_t>(_index + i * 8) : _offsets[i]; }
+
+auto RecordReader::record(size_t i) const -> std::expected<std::string_view, Error> {
+  if (i >= _count) {
+    return std::unexpected(Error(std::format("record {} out of range of {} records", i, _count)));
+  }
+  size_t frame_header = checksummed() ? 8 : 4;
+  uint64_t offset = _offset(i);
+  if (offset < RecordFormat::header_size || offset > _data.size() || _data.size() - offset < frame_header) {
+    return std::unexpected(Error(std::format("record {}: invalid offset {}", i, offset)));
+  }
+  size_t size = get_le<uint32_t>(_data.data() + offset);
+  if (_data.size() - offset - frame_header < size) {
+    return std::unexpected(Error(std::format("record {}: truncated", i)));
+  }
+  auto payload = _data.substr(offset + frame_header, size);
+  if (checksummed() &&
+      _impl::simd::crc32c(payload.data(), payload.size()) != get_le<uint32_t>(_data.data() + offset + 4)) {
+    return std::unexpected(Error(std::format("record {}: checksum mismatch", i)));
+  }
+  return payload;
+}
+
+}  // namespace proto
@@ -0,0 +1,417 @@
+#include "simd.h"
+
+#include <array>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PROTO_SIMD_X86 1
+#endif
+
+namespace proto::_impl::simd {
+
+namespace {
+
+template <typename U>
+void byteswap_scalar(char* data, size_t count) {
+  for (size_t i = 0; i < count; ++i, data += sizeof(U)) {
+    U v;
+    std::memcpy(&v, data, sizeof(U));
+    v = std::byteswap(v);
+    std::memcpy(data, &v, sizeof(U));
+  }
+}
+
+void byteswap_scalar(char* data, size_t count, size_t width) {
+  switch (width) {
+    case 2:
+      return byteswap_scalar<uint16_t>(data, count);
+    case 4:
+      return byteswap_scalar<uint32_t>(data, count);
+    case 8:
+      return byteswap_scalar<uint64_t>(data, count);
+  }
+}
+
+#ifdef PROTO_SIMD_X86
+
+// shuffle control which reverses every `width` bytes of a 16 bytes lane
+template <size_t width>
+constexpr auto shuffle_mask() {
+  struct {
+    char bytes[16];
+  } mask;
+  for (size_t i = 0; i < 16; ++i) {
+    mask.bytes[i] = static_cast<char>(i / width * width + width - 1 - i % width);
+  }
+  return mask;
+}
+
+template <size_t width>
+__attribute__((target("ssse3"))) void byteswap_ssse3(char* data, size_t count) {
+  static constexpr auto mask_bytes = shuffle_mask<width>();
+  const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask_bytes.bytes));
+  size_t bytes = count * width;
+  size_t i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    auto p = reinterpret_cast<__m128i*>(data + i);
+    _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), mask));
+  }
+  byteswap_scalar(data + i, (bytes - i) / width, width);
+}
+
+template <size_t width>
+__attribute__((target("avx2"))) void byteswap_avx2(char* data, size_t count) {
+  static constexpr auto mask_bytes = shuffle_mask<width>();
+  const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask_bytes.bytes)));
+  size_t bytes = count * width;
+  size_t i = 0;
+  for (; i + 32 <= bytes; i += 32) {
+    auto p = reinterpret_cast<__m256i*>(data + i);
+    _mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), mask));
+  }
+  byteswap_scalar(data + i, (bytes - i) / width, width);
+}
+
+template <size_t width>
+using Kernel = void (*)(char*, size_t);
+
+template <size_t width>
+Kernel<width> select_kernel() {
+  if (__builtin_cpu_supports("avx2")) {
+    return byteswap_avx2<width>;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return byteswap_ssse3<width>;
+  }
+  return byteswap_scalar<std::conditional_t<width == 2, uint16_t, std::conditional_t<width == 4, uint32_t, uint64_t>>>;
+}
+
+template <size_t width>
+void byteswap_dispatch(char* data, size_t count) {
+  static const Kernel<width> kernel = select_kernel<width>();
+  kernel(data, count);
+}
+
+#endif
+
+// bits of the characters in a 64 bytes block, bit i for byte i
+struct Block {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t blank;
+  uint64_t op;
+};
+
+using Classifier = Block (*)(const char*);
+
+Block classify_scalar(const char* data) {
+  Block b = {};
+  for (size_t i = 0; i < 64; ++i) {
+    uint64_t bit = uint64_t(1) << i;
+    switch (data[i]) {
+      case '"':
+        b.quote |= bit;
+        break;
+      case '\\':
+        b.backslash |= bit;
+        break;
+      case ' ':
+      case '\n':
+      case '\t':
+      case '\r':
+        b.blank |= bit;
+        break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        b.op |= bit;
+        break;
+    }
+  }
+  return b;
+}
+
+#ifdef PROTO_SIMD_X86
+
+// lookups by the low nibble, which select the only candidate character with it to compare the input with. The unused
+// 0x80 entries never compare equal, as inputs with the high bit set shuffle to zero
+constexpr auto nibble_table(std::initializer_list<char> chars) {
+  struct {
+    char bytes[16];
+  } table;
+  for (auto& b : table.bytes) {
+    b = '\x80';
+  }
+  for (char c : chars) {
+    table.bytes[c & 0xf] = c;
+  }
+  return table;
+}
+
+// `:` `[` `,` `]` and `{` `}` share low nibbles, so the operators take two lookups
+constexpr auto blank_table = nibble_table({' ', '\t', '\n', '\r'});
+constexpr auto op_table = nibble_table({':', '[', ',', ']'});
+constexpr auto brace_table = nibble_table({'{', '}'});
+
+__attribute__((target("avx2"))) __m256i broadcast_table(const char* bytes) {
+  return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)));
+}
+
+__attribute__((target("avx2"))) Block classify_avx2(const char* data) {
+  const __m256i blank = broadcast_table(blank_table.bytes);
+  const __m256i op = broadcast_table(op_table.bytes);
+  const __m256i brace = broadcast_table(brace_table.bytes);
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  Block b = {};
+  for (size_t i = 0; i < 64; i += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    // bytes with the high bit set shuffle to zero, which never equals them
+    __m256i is_blank = _mm256_cmpeq_epi8(_mm256_shuffle_epi8(blank, v), v);
+    __m256i is_op = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(op, v), v),
+                                    _mm256_cmpeq_epi8(_mm256_shuffle_epi8(brace, v), v));
+    b.quote |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << i;
+    b.backslash |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)))) << i;
+    b.blank |= uint64_t(uint32_t(_mm256_movemask_epi8(is_blank))) << i;
+    b.op |= uint64_t(uint32_t(_mm256_movemask_epi8(is_op))) << i;
+  }
+  return b;
+}
+
+__attribute__((target("ssse3"))) Block classify_ssse3(const char* data) {
+  const __m128i blank = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blank_table.bytes));
+  const __m128i op = _mm_loadu_si128(reinterpret_cast<const __m128i*>(op_table.bytes));
+  const __m128i brace = _mm_loadu_si128(reinterpret_cast<const __m128i*>(brace_table.bytes));
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  Block b = {};
+  for (size_t i = 0; i < 64; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i is_blank = _mm_cmpeq_epi8(_mm_shuffle_epi8(blank, v), v);
+    __m128i is_op =
+        _mm_or_si128(_mm_cmpeq_epi8(_mm_shuffle_epi8(op, v), v), _mm_cmpeq_epi8(_mm_shuffle_epi8(brace, v), v));
+    b.quote |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << i;
+    b.backslash |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << i;
+    b.blank |= uint64_t(uint32_t(_mm_movemask_epi8(is_blank))) << i;
+    b.op |= uint64_t(uint32_t(_mm_movemask_epi8(is_op))) << i;
+  }
+  return b;
+}
+
+#endif
+
+Classifier select_classifier() {
+#ifdef PROTO_SIMD_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return classify_avx2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return classify_ssse3;
+  }
+#endif
+  return classify_scalar;
+}
+
+// xor of all the bits up to and including each bit
+uint64_t prefix_xor(uint64_t bits) {
+  for (size_t shift = 1; shift < 64; shift *= 2) {
+    bits ^= bits << shift;
+  }
+  return bits;
+}
+
+// bits of the characters escaped by an odd run of backslashes before them, `carry` tells whether the first character
+// of the block is escaped and is updated for the next block
+uint64_t escaped(uint64_t backslash, uint64_t& carry) {
+  constexpr uint64_t even = 0x5555555555555555;
+  // an escaped backslash escapes nothing
+  backslash &= ~carry;
+  uint64_t follows = backslash << 1 | carry;
+  // adding the starts of the runs at odd bits carries through those runs, and flips which parity of the bits right
+  // after the runs marks an odd run length
+  uint64_t odd_starts = backslash & ~even & ~follows;
+  uint64_t even_ends;
+  carry = __builtin_add_overflow(odd_starts, backslash, &even_ends);
+  return (even ^ (even_ends << 1)) & follows;
+}
+
+template <bool controls>
+size_t find_scalar(const char* data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    if (data[i] == '"' || data[i] == '\\' || (controls && static_cast<unsigned char>(data[i]) < 0x20)) {
+      return i;
+    }
+  }
+  return size;
+}
+
+#ifdef PROTO_SIMD_X86
+
+template <bool controls>
+__attribute__((target("avx2"))) size_t find_avx2(const char* data, size_t size) {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i control_max = _mm256_set1_epi8(0x1f);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash));
+    if constexpr (controls) {
+      hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(_mm256_max_epu8(v, control_max), control_max));
+    }
+    if (uint32_t mask = _mm256_movemask_epi8(hit); mask) {
+      return i + std::countr_zero(mask);
+    }
+  }
+  return i + find_scalar<controls>(data + i, size - i);
+}
+
+template <bool controls>
+__attribute__((target("sse2"))) size_t find_sse2(const char* data, size_t size) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control_max = _mm_set1_epi8(0x1f);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+    if constexpr (controls) {
+      hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_max_epu8(v, control_max), control_max));
+    }
+    if (uint32_t mask = _mm_movemask_epi8(hit); mask) {
+      return i + std::countr_zero(mask);
+    }
+  }
+  return i + find_scalar<controls>(data + i, size - i);
+}
+
+#endif
+
+using Finder = size_t (*)(const char*, size_t);
+
+template <bool controls>
+Finder select_finder() {
+#ifdef PROTO_SIMD_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return find_avx2<controls>;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return find_sse2<controls>;
+  }
+#endif
+  return find_scalar<controls>;
+}
+
+// reflected polynomial 0x1edc6f41 of crc32c, one byte a step
+constexpr auto crc32c_table = [] {
+  std::array<uint32_t, 256> table;
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int k = 0; k < 8; ++k) {
+      crc = crc & 1 ? crc >> 1 ^ 0x82f63b78 : crc >> 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+uint32_t crc32c_scalar(const char* data, size_t size, uint32_t crc) {
+  for (size_t i = 0; i < size; ++i) {
+    crc = crc32c_table[(crc ^ static_cast<unsigned char>(data[i])) & 0xff] ^ crc >> 8;
+  }
+  return crc;
+}
+
+#ifdef PROTO_SIMD_X86
+
+__attribute__((target("sse4.2"))) uint32_t crc32c_sse42(const char* data, size_t size, uint32_t crc) {
+  size_t i = 0;
+#ifdef __x86_64__
+  uint64_t crc64 = crc;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t v;
+    std::memcpy(&v, data + i, 8);
+    crc64 = _mm_crc32_u64(crc64, v);
+  }
+  crc = static_cast<uint32_t>(crc64);
+#endif
+  for (; i < size; ++i) {
+    crc = _mm_crc32_u8(crc, static_cast<unsigned char>(data[i]));
+  }
+  return crc;
+}
+
+#endif
+
+}  // namespace
+
+uint32_t crc32c(const char* data, size_t size, uint32_t crc) {
+#ifdef PROTO_SIMD_X86
+  static const auto kernel = __builtin_cpu_supports("sse4.2") ? crc32c_sse42 : crc32c_scalar;
+#else
+  static const auto kernel = crc32c_scalar;
+#endif
+  return ~kernel(data, size, ~crc);
+}
+
+size_t json_tokens(const char* data, size_t size, uint32_t* out) {
+  static const Classifier classify = select_classifier();
+  uint64_t in_string = 0;    // all ones if the previous block ends inside a string
+  uint64_t prev_scalar = 0;  // whether the previous block ends with a non structural character
+  uint64_t prev_escape = 0;  // whether the previous block ends with an escaping backslash
+  size_t n = 0;
+  for (size_t base = 0; base < size; base += 64) {
+    Block b;
+    if (size - base >= 64) {
+      b = classify(data + base);
+    } else {
+      // blanks pad the tail, which adds no token
+      char tail[64];
+      std::memset(tail, ' ', 64);
+      std::memcpy(tail, data + base, size - base);
+      b = classify(tail);
+    }
+    b.quote &= ~escaped(b.backslash, prev_escape);
+    // opening quotes and string contents are set, closing quotes are not
+    uint64_t string = prefix_xor(b.quote) ^ in_string;
+    in_string = static_cast<uint64_t>(static_cast<int64_t>(string) >> 63);
+    uint64_t scalar = ~(b.quote | b.blank | b.op | string);
+    uint64_t tokens = (b.op & ~string) | (b.quote & string) | (scalar & ~(scalar << 1 | prev_scalar));
+    prev_scalar = scalar >> 63;
+    for (; tokens; tokens &= tokens - 1) {
+      out[n++] = static_cast<uint32_t>(base + std::countr_zero(tokens));
+    }
+  }
+  return n;
+}
+
+size_t find_quote(const char* data, size_t size) {
+  static const Finder find = select_finder<false>();
+  return find(data, size);
+}
+
+size_t find_escape(const char* data, size_t size) {
+  static const Finder find = select_finder<true>();
+  return find(data, size);
+}
+
+void byteswap(char* data, size_t count, size_t width) {
+#ifdef PROTO_SIMD_X86
+  switch (width) {
+    case 2:
+      return byteswap_dispatch<2>(data, count);
+    case 4:
+      return byteswap_dispatch<4>(data, count);
+    case 8:
+      return byteswap_dispatch<8>(data, count);
+  }
+#else
+  byteswap_scalar(data, count, width);
+#endif
+}
+
+}  // namespace proto::_impl::simd
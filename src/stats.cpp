@@ -0,0 +1,112 @@
+#include "stats.h"
+
+#include <cxxabi.h>
+
+#include <bit>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+
+namespace proto {
+
+namespace {
+
+std::mutex registry_mutex;
+
+std::vector<_impl::ModelCounters*>& registry() {
+  static std::vector<_impl::ModelCounters*> registry;
+  return registry;
+}
+
+std::string demangle(const char* name) {
+  int status;
+  std::unique_ptr<char, decltype(&std::free)> demangled(abi::__cxa_demangle(name, nullptr, nullptr, &status),
+                                                        &std::free);
+  return status == 0 ? demangled.get() : name;
+}
+
+}  // namespace
+
+namespace _impl {
+
+void OpCounters::_time(uint64_t elapsed) {
+  _add(_timed, 1);
+  _add(_nanoseconds, elapsed);
+  size_t bucket = elapsed > 0 ? std::bit_width(elapsed) - 1 : 0;
+  _add(_histogram[std::min(bucket, OpStats::buckets - 1)], 1);
+}
+
+void OpCounters::add_to(OpStats& stats) const {
+  stats.calls += _calls.load(std::memory_order_relaxed);
+  stats.failures += _failures.load(std::memory_order_relaxed);
+  stats.bytes += _bytes.load(std::memory_order_relaxed);
+  stats.timed += _timed.load(std::memory_order_relaxed);
+  stats.nanoseconds += _nanoseconds.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < OpStats::buckets; ++i) {
+    stats.histogram[i] += _histogram[i].load(std::memory_order_relaxed);
+  }
+}
+
+void OpCounters::reset() {
+  for (auto* counter : {&_calls, &_failures, &_bytes, &_timed, &_nanoseconds}) {
+    counter->store(0, std::memory_order_relaxed);
+  }
+  for (auto& counter : _histogram) {
+    counter.store(0, std::memory_order_relaxed);
+  }
+}
+
+ModelCounters::ModelCounters(const std::type_info& type) : _type(type) {
+  std::lock_guard lock(registry_mutex);
+  registry().push_back(this);
+}
+
+auto ModelCounters::acquire() -> StatsShard* {
+  std::lock_guard lock(_mutex);
+  for (auto& shard : _shards) {
+    if (!shard.owned.load(std::memory_order_acquire)) {
+      shard.owned.store(true, std::memory_order_relaxed);
+      return &shard;
+    }
+  }
+  return &_shards.emplace_back();
+}
+
+auto ModelCounters::snapshot() -> ModelStats {
+  ModelStats stats = {.model = demangle(_type.name())};
+  std::lock_guard lock(_mutex);
+  for (auto& shard : _shards) {
+    shard.encode.add_to(stats.encode);
+    shard.decode.add_to(stats.decode);
+  }
+  return stats;
+}
+
+void ModelCounters::reset() {
+  std::lock_guard lock(_mutex);
+  for (auto& shard : _shards) {
+    shard.encode.reset();
+    shard.decode.reset();
+  }
+}
+
+}  // namespace _impl
+
+auto stats_snapshot() -> std::vector<ModelStats> {
+  std::lock_guard lock(registry_mutex);
+  std::vector<ModelStats> snapshot;
+  snapshot.reserve(registry().size());
+  for (auto* counters : registry()) {
+    snapshot.push_back(counters->snapshot());
+  }
+  return snapshot;
+}
+
+void stats_reset() {
+  std::lock_guard lock(registry_mutex);
+  for (auto* counters : registry()) {
+    counters->reset();
+  }
+}
+
+}  // namespace proto
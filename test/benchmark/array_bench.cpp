@@ -0,0 +1,95 @@
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "mbench.h"
+#include "proto.h"
+
+// the element by element path, which every array took before
+struct ElementwiseCodec : public proto::BinaryCodec {
+  template <typename T>
+  void encode_each(const std::vector<T>& arr) {
+    _encode_varible_len(arr.size());
+    for (auto& v : arr) {
+      encode(v);
+    }
+  }
+
+  template <typename T>
+  auto decode_each(std::vector<T>& arr) -> std::expected<void, Error> {
+    auto len = _decode_variable_len();
+    if (!len) {
+      return std::unexpected(std::move(len.error()));
+    }
+    arr.clear();
+    for (VariableLength i = 0; i < *len; ++i) {
+      T val{};
+      if (auto r = decode(val); !r) {
+        return r;
+      }
+      arr.emplace_back(val);
+    }
+    return {};
+  }
+};
+
+template <typename T>
+void bench_array(const char* type_name) {
+  constexpr size_t size = 200000;
+  constexpr size_t iterations = 200;
+  std::vector<T> arr(size);
+  std::iota(arr.begin(), arr.end(), T(0));
+  std::string out;
+
+  auto label = [type_name](const char* what) { return std::string(type_name) + " " + what; };
+
+  mbench::measure(
+      label("encode element by element").c_str(), iterations,
+      [&]() {
+        out.clear();
+        ElementwiseCodec codec;
+        codec.sink().append_to(out);
+        codec.encode_each(arr);
+        codec.sink().finish();
+      },
+      size);
+  mbench::measure(
+      label("encode bulk").c_str(), iterations,
+      [&]() {
+        out.clear();
+        proto::BinaryCodec codec;
+        codec.sink().append_to(out);
+        codec.encode(arr);
+        codec.sink().finish();
+      },
+      size);
+
+  std::vector<T> res;
+  mbench::measure(
+      label("decode element by element").c_str(), iterations,
+      [&]() {
+        ElementwiseCodec codec;
+        codec.source().reset(out);
+        auto r = codec.decode_each(res);
+        mbench::do_not_optimize(r);
+        mbench::do_not_optimize(res);
+      },
+      size);
+  mbench::measure(
+      label("decode bulk").c_str(), iterations,
+      [&]() {
+        proto::BinaryCodec codec;
+        codec.source().reset(out);
+        auto r = codec.decode(res);
+        mbench::do_not_optimize(r);
+        mbench::do_not_optimize(res);
+      },
+      size);
+}
+
+BENCH(array, binary) {
+  bench_array<float>("float");
+  bench_array<uint32_t>("uint32");
+  bench_array<double>("double");
+  bench_array<uint16_t>("uint16");
+}
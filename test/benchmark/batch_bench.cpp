@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "mbench.h"
+#include "proto.h"
+
+template <typename C = proto::BinaryCodec>
+struct User : public proto::BaseModel<User<C>> {
+  using Model = User;
+
+  PROTO_FIELD(uint32_t, id, 0);
+  PROTO_FIELD(std::string, name, "unkown");
+  PROTO_FIELD(bool, is_vip, false);
+  PROTO_FIELD(std::vector<uint32_t>, groups, {});
+};
+
+template <typename Codec>
+void bench_codec(const char* codec_name, const std::vector<User<>>& users) {
+  constexpr size_t iterations = 20;
+  auto label = [codec_name](const char* what, size_t threads) {
+    return std::string(codec_name) + " " + what + ", " + std::to_string(threads) + " threads";
+  };
+  // the serial baseline encodes every model into a string of its own
+  mbench::measure((std::string(codec_name) + " encode_by one by one").c_str(), iterations, [&]() {
+    std::vector<std::string> out;
+    for (auto& user : users) {
+      out.push_back(user.template encode_by<Codec>().value());
+    }
+    mbench::do_not_optimize(out);
+  }, users.size());
+
+  size_t max_threads = std::max(4u, std::thread::hardware_concurrency());
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    proto::ThreadPool pool(threads);
+    auto batch = proto::encode_batch<Codec>(users, &pool).value();
+    mbench::measure(label("encode_batch", threads).c_str(), iterations, [&]() {
+      auto res = proto::encode_batch<Codec>(users, &pool);
+      mbench::do_not_optimize(res);
+    }, users.size());
+    mbench::measure(label("decode_batch", threads).c_str(), iterations, [&]() {
+      auto res = proto::decode_batch<Codec, User<>>(batch, &pool);
+      mbench::do_not_optimize(res);
+    }, users.size());
+  }
+}
+
+BENCH(batch, users) {
+  std::vector<User<>> users;
+  for (uint32_t i = 0; i < 100000; ++i) {
+    users.push_back({.id = i, .name = "user name #" + std::to_string(i), .groups = {i % 7, i % 11, i % 13}});
+  }
+  std::printf("  %zu users, %u hardware threads\n", users.size(), std::thread::hardware_concurrency());
+  bench_codec<proto::BinaryCodec>("binary", users);
+  bench_codec<proto::JsonCodec>("json", users);
+}
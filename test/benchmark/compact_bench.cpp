@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mbench.h"
+#include "proto.h"
+
+template <typename C = proto::BinaryCodec>
+struct User : public proto::BaseModel<User<C>> {
+  using Model = User;
+
+  PROTO_FIELD(uint32_t, id, 0);
+  PROTO_FIELD(std::string, name, "unkown");
+  PROTO_FIELD(bool, is_vip, false);
+};
+
+template <typename C = proto::BinaryCodec>
+struct UserResponse : public proto::BaseModel<UserResponse<C>> {
+  using Model = UserResponse;
+
+  PROTO_FIELD(User<>, user, {});
+  PROTO_FIELD(std::vector<User<>>, followers, {});
+};
+
+template <typename C = proto::BinaryCodec>
+struct Message : public proto::BaseModel<Message<C>> {
+  using Model = Message;
+
+  PROTO_FIELD(uint32_t, code, 0);
+  PROTO_FIELD(std::string, msg, "");
+  PROTO_FIELD(UserResponse<>, data, {});
+};
+
+auto make_message(size_t followers) {
+  Message<> msg = {.code = 200, .msg = "ok", .data = {.user = {.id = 1, .name = "Alice", .is_vip = true}}};
+  for (size_t i = 0; i < followers; ++i) {
+    msg.data.followers.push_back({.id = uint32_t(i * 37 % 5000), .name = "user" + std::to_string(i)});
+  }
+  return msg;
+}
+
+template <typename Codec>
+void bench_codec(const char* codec_name, const Message<>& msg) {
+  constexpr size_t iterations = 2000;
+  auto encoded = msg.template encode_by<Codec>().value();
+  std::printf("    %s: %zu bytes\n", codec_name, encoded.size());
+
+  std::string out;
+  mbench::measure((std::string(codec_name) + " encode").c_str(), iterations, [&]() {
+    out.clear();
+    msg.template encode_by<Codec>(out);
+    mbench::do_not_optimize(out);
+  });
+  mbench::measure((std::string(codec_name) + " decode").c_str(), iterations, [&]() {
+    auto res = Message<>::decode_by<Codec>(encoded);
+    mbench::do_not_optimize(res);
+  });
+}
+
+BENCH(compact, message) {
+  for (size_t followers : {1, 100, 1000}) {
+    std::printf("  message with %zu followers\n", followers);
+    auto msg = make_message(followers);
+    bench_codec<proto::BinaryCodec>("binary", msg);
+    bench_codec<proto::CompactBinaryCodec>("compact binary", msg);
+  }
+}
@@ -0,0 +1,117 @@
+#include <cstring>
+#include <string>
+
+#include "mbench.h"
+#include "proto.h"
+
+template <typename C = proto::BinaryCodec>
+struct Wide : public proto::BaseModel<Wide<C>> {
+  using Model = Wide;
+
+  PROTO_FIELD(uint32_t, f0, 0);
+  PROTO_FIELD(uint32_t, f1, 1);
+  PROTO_FIELD(uint32_t, f2, 2);
+  PROTO_FIELD(uint32_t, f3, 3);
+  PROTO_FIELD(uint64_t, f4, 4);
+  PROTO_FIELD(uint64_t, f5, 5);
+  PROTO_FIELD(uint64_t, f6, 6);
+  PROTO_FIELD(uint64_t, f7, 7);
+  PROTO_FIELD(float, f8, 8);
+  PROTO_FIELD(float, f9, 9);
+  PROTO_FIELD(float, f10, 10);
+  PROTO_FIELD(float, f11, 11);
+  PROTO_FIELD(double, f12, 12);
+  PROTO_FIELD(double, f13, 13);
+  PROTO_FIELD(double, f14, 14);
+  PROTO_FIELD(double, f15, 15);
+};
+
+// a hand-written encoder for `Wide`, field by field with no field table in between
+template <typename Codec>
+void encode_by_hand(Codec& codec, const Wide<>& w) {
+  codec.encode(w.f0), codec.encode(w.f1), codec.encode(w.f2), codec.encode(w.f3);
+  codec.encode(w.f4), codec.encode(w.f5), codec.encode(w.f6), codec.encode(w.f7);
+  codec.encode(w.f8), codec.encode(w.f9), codec.encode(w.f10), codec.encode(w.f11);
+  codec.encode(w.f12), codec.encode(w.f13), codec.encode(w.f14), codec.encode(w.f15);
+}
+
+template <typename Codec>
+void bench_codec(const char* by_table, const char* by_hand) {
+  constexpr size_t iterations = 200000;
+  constexpr size_t fields = Wide<>::field_count();
+  Wide<> wide;
+  std::string out;
+
+  mbench::measure(
+      by_table, iterations,
+      [&]() {
+        out.clear();
+        Codec codec;
+        codec.sink().append_to(out);
+        codec.encode(wide);
+        codec.sink().finish();
+        mbench::do_not_optimize(out);
+      },
+      fields);
+  mbench::measure(
+      by_hand, iterations,
+      [&]() {
+        out.clear();
+        Codec codec;
+        codec.sink().append_to(out);
+        encode_by_hand(codec, wide);
+        codec.sink().finish();
+        mbench::do_not_optimize(out);
+      },
+      fields);
+}
+
+// the floor: a copy of the field bytes, as they lie in memory
+void bench_memcpy(const char* label, bool encode) {
+  constexpr size_t iterations = 200000;
+  constexpr size_t bytes = 4 * (sizeof(uint32_t) + sizeof(uint64_t) + sizeof(float) + sizeof(double));
+  Wide<> wide;
+  std::string out(bytes, '\0');
+  mbench::measure(
+      label, iterations,
+      [&]() {
+        encode ? std::memcpy(out.data(), &wide.f0, bytes) : std::memcpy(&wide.f0, out.data(), bytes);
+        mbench::do_not_optimize(out);
+        mbench::do_not_optimize(wide);
+      },
+      Wide<>::field_count());
+}
+
+BENCH(field, encode) {
+  bench_codec<proto::BinaryCodec>("binary encode by field table", "binary encode by hand");
+  bench_codec<proto::LittleEndianBinaryCodec>("little endian encode by field table", "little endian encode by hand");
+  bench_codec<proto::ReprCodec>("repr encode by field table", "repr encode by hand");
+  bench_memcpy("memcpy of field bytes", true);
+}
+
+BENCH(field, decode) {
+  constexpr size_t iterations = 200000;
+  auto bin = Wide<>{}.encode_by<proto::BinaryCodec>().value();
+  auto little = Wide<>{}.encode_by<proto::LittleEndianBinaryCodec>().value();
+  Wide<> wide;
+
+  mbench::measure(
+      "binary decode by field table", iterations,
+      [&]() {
+        proto::BinaryCodec codec;
+        codec.source().reset(bin);
+        codec.decode(wide);
+        mbench::do_not_optimize(wide);
+      },
+      Wide<>::field_count());
+  mbench::measure(
+      "little endian decode by field table", iterations,
+      [&]() {
+        proto::LittleEndianBinaryCodec codec;
+        codec.source().reset(little);
+        codec.decode(wide);
+        mbench::do_not_optimize(wide);
+      },
+      Wide<>::field_count());
+  bench_memcpy("memcpy of field bytes", false);
+}
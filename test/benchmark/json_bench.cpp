@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mbench.h"
+#include "proto.h"
+
+template <typename C = proto::JsonCodec>
+struct User : public proto::BaseModel<User<C>> {
+  using Model = User;
+
+  PROTO_FIELD(uint32_t, id, 0);
+  PROTO_FIELD(std::string, name, "unkown");
+  PROTO_FIELD(bool, is_vip, false);
+};
+
+template <typename C = proto::JsonCodec>
+struct UserResponse : public proto::BaseModel<UserResponse<C>> {
+  using Model = UserResponse;
+
+  PROTO_FIELD(User<>, user, {});
+  PROTO_FIELD(std::vector<User<>>, followers, {});
+};
+
+template <typename C = proto::JsonCodec>
+struct Message : public proto::BaseModel<Message<C>> {
+  using Model = Message;
+
+  PROTO_FIELD(uint32_t, code, 0);
+  PROTO_FIELD(std::string, msg, "");
+  PROTO_FIELD(UserResponse<>, data, {});
+};
+
+// the json decoder without structural index, which scans blanks one by one
+class ScalarJsonCodec : public proto::JsonCodec {
+ public:
+  ScalarJsonCodec() { _tokenize = false; }
+};
+
+auto make_message(size_t followers) {
+  Message<> msg = {.code = 200, .msg = "ok", .data = {.user = {.id = 1, .name = "Alice", .is_vip = true}}};
+  for (size_t i = 0; i < followers; ++i) {
+    msg.data.followers.push_back({.id = uint32_t(i * 37 % 5000), .name = "user" + std::to_string(i)});
+  }
+  return msg;
+}
+
+// indent compact json by two spaces a level
+std::string pretty(std::string_view json) {
+  std::string out;
+  size_t depth = 0;
+  bool in_string = false;
+  auto new_line = [&]() { out += '\n', out.append(depth * 2, ' '); };
+  for (char c : json) {
+    if (in_string || c == '"') {
+      in_string ^= c == '"';
+      out += c;
+    } else if (c == '{' || c == '[') {
+      out += c, ++depth, new_line();
+    } else if (c == '}' || c == ']') {
+      --depth, new_line(), out += c;
+    } else if (c == ',') {
+      out += c, new_line();
+    } else {
+      out += c == ':' ? ": " : std::string(1, c);
+    }
+  }
+  return out;
+}
+
+// the default decoder takes the bare label, which a run of an earlier tree can be compared with by `--diff`
+template <typename Codec>
+void bench_decode(const std::string& label, const std::string& json, size_t users) {
+  constexpr size_t iterations = 200;
+  mbench::measure(label.c_str(), iterations, [&]() {
+    auto res = Message<>::decode_by<Codec>(json);
+    mbench::do_not_optimize(res);
+  }, users, json.size());
+}
+
+BENCH(json, decode) {
+  for (size_t followers : {10, 1000, 10000}) {
+    auto compact = make_message(followers).encode().value();
+    auto indented = pretty(compact);
+    std::printf("  message with %zu followers, compact %zu bytes, pretty %zu bytes\n", followers, compact.size(),
+                indented.size());
+    // the user and its followers
+    size_t users = followers + 1;
+    auto label = std::to_string(followers) + " followers, ";
+    bench_decode<proto::JsonCodec>(label + "compact", compact, users);
+    bench_decode<ScalarJsonCodec>(label + "compact, no index", compact, users);
+    bench_decode<proto::JsonCodec>(label + "pretty", indented, users);
+    bench_decode<ScalarJsonCodec>(label + "pretty, no index", indented, users);
+  }
+}
@@ -0,0 +1,98 @@
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mbench.h"
+#include "proto.h"
+
+template <typename C = proto::JsonCodec>
+struct Series : public proto::BaseModel<Series<C>> {
+  using Model = Series;
+
+  PROTO_FIELD(std::vector<double>, values, {});
+  PROTO_FIELD(std::vector<float>, ratios, {});
+  PROTO_FIELD(std::vector<int64_t>, stamps, {});
+};
+
+auto make_series(size_t size) {
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> real(-1e6, 1e6);
+  Series<> series;
+  for (size_t i = 0; i < size; ++i) {
+    series.values.push_back(real(rng));
+    series.ratios.push_back(static_cast<float>(real(rng) / 1e6));
+    series.stamps.push_back(static_cast<int64_t>(rng() >> 12) - (int64_t(1) << 51));
+  }
+  return series;
+}
+
+// round trip formatting through streams, as text codecs did before `to_chars`
+template <typename T>
+void stream_encode(std::ostringstream& os, const std::vector<T>& arr) {
+  os << '[';
+  for (size_t i = 0; i < arr.size(); ++i) {
+    os << (i > 0 ? "," : "") << arr[i];
+  }
+  os << ']';
+}
+
+template <typename T>
+void stream_decode(std::istringstream& is, std::vector<T>& arr) {
+  char c;
+  is >> c;
+  for (T v; is >> v; is >> c) {
+    arr.push_back(v);
+    if (is.peek() == ']') {
+      break;
+    }
+  }
+  is >> c;
+}
+
+template <typename Codec>
+void bench_codec(const char* codec_name, const Series<>& series, size_t items) {
+  constexpr size_t iterations = 50;
+  auto encoded = series.template encode_by<Codec>().value();
+  std::string out;
+  mbench::measure((std::string(codec_name) + " encode").c_str(), iterations, [&]() {
+    out.clear();
+    series.template encode_by<Codec>(out);
+    mbench::do_not_optimize(out);
+  }, items);
+  mbench::measure((std::string(codec_name) + " decode").c_str(), iterations, [&]() {
+    auto res = Series<>::decode_by<Codec>(encoded);
+    mbench::do_not_optimize(res);
+  }, items);
+}
+
+BENCH(numeric, arrays) {
+  constexpr size_t size = 20000;
+  constexpr size_t iterations = 50;
+  auto series = make_series(size);
+  std::printf("  %zu doubles, floats and int64s\n", size);
+
+  std::string text;
+  mbench::measure("stream encode, max_digits10", iterations, [&]() {
+    std::ostringstream os;
+    os.precision(std::numeric_limits<double>::max_digits10);
+    stream_encode(os, series.values);
+    os.precision(std::numeric_limits<float>::max_digits10);
+    stream_encode(os, series.ratios);
+    stream_encode(os, series.stamps);
+    text = os.str();
+  }, size * 3);
+  mbench::measure("stream decode", iterations, [&]() {
+    std::istringstream is(text);
+    Series<> res;
+    stream_decode(is, res.values);
+    stream_decode(is, res.ratios);
+    stream_decode(is, res.stamps);
+    mbench::do_not_optimize(res);
+  }, size * 3);
+
+  bench_codec<proto::ReprCodec>("repr", series, size * 3);
+  bench_codec<proto::JsonCodec>("json", series, size * 3);
+}
@@ -0,0 +1,82 @@
+#include <string>
+#include <vector>
+
+#include "mbench.h"
+#include "proto.h"
+#include "view.h"
+
+template <typename C = proto::BinaryCodec>
+struct User : public proto::BaseModel<User<C>> {
+  using Model = User;
+
+  PROTO_FIELD(uint32_t, id, 0);
+  PROTO_FIELD(std::string, name, "unkown");
+  PROTO_FIELD(bool, is_vip, false);
+  PROTO_FIELD(std::vector<uint32_t>, groups, {});
+};
+
+template <typename C = proto::BinaryCodec>
+struct UserResponse : public proto::BaseModel<UserResponse<C>> {
+  using Model = UserResponse;
+
+  PROTO_FIELD(User<>, user, {});
+  PROTO_FIELD(std::vector<User<>>, followers, {});
+};
+
+template <typename C = proto::BinaryCodec>
+struct Message : public proto::BaseModel<Message<C>> {
+  using Model = Message;
+
+  PROTO_FIELD(uint32_t, code, 0);
+  PROTO_FIELD(std::string, msg, "");
+  PROTO_FIELD(UserResponse<>, data, {});
+};
+
+BENCH(projection, code_and_user_id) {
+  constexpr size_t iterations = 2000;
+  Message<> message = {.code = 200, .msg = "ok", .data = {.user = {.id = 42, .name = "Alice"}}};
+  for (uint32_t i = 0; i < 1000; ++i) {
+    message.data.followers.push_back({.id = i, .name = "follower #" + std::to_string(i), .groups = {i, i + 1}});
+  }
+  auto binary = message.encode_by<proto::BinaryCodec>().value();
+  auto sized = message.encode_by<proto::SizedBinaryCodec>().value();
+  auto table = message.encode_by<proto::TableBinaryCodec>().value();
+
+  mbench::measure("binary full decode", iterations, [&]() {
+    auto msg = Message<>::decode_by<proto::BinaryCodec>(binary);
+    mbench::do_not_optimize(msg);
+  });
+  mbench::measure("sized binary full decode", iterations, [&]() {
+    auto msg = Message<>::decode_by<proto::SizedBinaryCodec>(sized);
+    mbench::do_not_optimize(msg);
+  });
+  mbench::measure("sized binary decode code and data.user.id", iterations, [&]() {
+    using proto::Path;
+    auto msg = Message<>::decode_fields<proto::SizedBinaryCodec, Path<&Message<>::code>,
+                                        Path<&Message<>::data, &UserResponse<>::user, &User<>::id>>(sized);
+    mbench::do_not_optimize(msg);
+  });
+  mbench::measure("sized binary decode data.followers.id", iterations, [&]() {
+    using FollowerIds = proto::Path<&Message<>::data, &UserResponse<>::followers, &User<>::id>;
+    auto msg = Message<>::decode_fields<proto::SizedBinaryCodec, FollowerIds>(sized);
+    mbench::do_not_optimize(msg);
+  });
+  mbench::measure("table binary view check", iterations, [&]() {
+    auto view = proto::View<Message<>>::of(table);
+    mbench::do_not_optimize(view);
+  });
+  mbench::measure("table binary view code and data.user.id", iterations, [&]() {
+    proto::View<Message<>> view(table.data());
+    uint64_t sum = view.get<&Message<>::code>();
+    sum += view.get<&Message<>::data>().get<&UserResponse<>::user>().get<&User<>::id>();
+    mbench::do_not_optimize(sum);
+  });
+  mbench::measure("table binary view data.followers.id", iterations, [&]() {
+    proto::View<Message<>> view(table.data());
+    uint64_t sum = 0;
+    for (auto follower : view.get<&Message<>::data>().get<&UserResponse<>::followers>()) {
+      sum += follower.get<&User<>::id>();
+    }
+    mbench::do_not_optimize(sum);
+  });
+}
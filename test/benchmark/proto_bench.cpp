@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "incremental.h"
+#include "mbench.h"
+#include "proto.h"
+#include "transcode.h"
+
+// the suite of all codecs over models of typical shapes, run with `--out FILE` to keep the results and with
+// `--compare FILE` to check a later build against them
+
+std::atomic<size_t> allocated = 0;
+
+void* operator new(size_t size) {
+  allocated.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+// shallow: a few scalars and a short string
+template <typename C = proto::BinaryCodec>
+struct User : public proto::BaseModel<User<C>> {
+  using Model = User;
+
+  PROTO_FIELD(uint32_t, id, 0);
+  PROTO_FIELD(std::string, name, "");
+  PROTO_FIELD(bool, is_vip, false);
+  PROTO_FIELD(double, score, 0);
+};
+
+// deep: models nested four levels down, with arrays of models on the way
+template <typename C = proto::BinaryCodec>
+struct Group : public proto::BaseModel<Group<C>> {
+  using Model = Group;
+
+  PROTO_FIELD(uint32_t, id, 0);
+  PROTO_FIELD(std::vector<User<>>, members, {});
+};
+
+template <typename C = proto::BinaryCodec>
+struct Department : public proto::BaseModel<Department<C>> {
+  using Model = Department;
+
+  PROTO_FIELD(std::string, name, "");
+  PROTO_FIELD(User<>, head, {});
+  PROTO_FIELD(std::vector<Group<>>, groups, {});
+};
+
+template <typename C = proto::BinaryCodec>
+struct Company : public proto::BaseModel<Company<C>> {
+  using Model = Company;
+
+  PROTO_FIELD(std::string, name, "");
+  PROTO_FIELD(std::vector<Department<>>, departments, {});
+};
+
+// wide: many fields of mixed types
+template <typename C = proto::BinaryCodec>
+struct Wide : public proto::BaseModel<Wide<C>> {
+  using Model = Wide;
+
+  PROTO_FIELD(uint32_t, u0, 0);
+  PROTO_FIELD(uint32_t, u1, 0);
+  PROTO_FIELD(uint64_t, u2, 0);
+  PROTO_FIELD(uint64_t, u3, 0);
+  PROTO_FIELD(int32_t, i0, 0);
+  PROTO_FIELD(int32_t, i1, 0);
+  PROTO_FIELD(int64_t, i2, 0);
+  PROTO_FIELD(int64_t, i3, 0);
+  PROTO_FIELD(float, f0, 0);
+  PROTO_FIELD(float, f1, 0);
+  PROTO_FIELD(double, d0, 0);
+  PROTO_FIELD(double, d1, 0);
+  PROTO_FIELD(bool, b0, false);
+  PROTO_FIELD(bool, b1, false);
+  PROTO_FIELD(std::string, s0, "");
+  PROTO_FIELD(std::string, s1, "");
+  PROTO_FIELD(std::string, s2, "");
+  PROTO_FIELD(std::string, s3, "");
+  PROTO_FIELD(uint32_t, u4, 0);
+  PROTO_FIELD(uint64_t, u5, 0);
+  PROTO_FIELD(double, d2, 0);
+  PROTO_FIELD(double, d3, 0);
+  PROTO_FIELD(std::vector<uint32_t>, tags, {});
+  PROTO_FIELD(std::string, s4, "");
+};
+
+// large array: long numeric series
+template <typename C = proto::BinaryCodec>
+struct Series : public proto::BaseModel<Series<C>> {
+  using Model = Series;
+
+  PROTO_FIELD(std::string, name, "");
+  PROTO_FIELD(std::vector<int64_t>, stamps, {});
+  PROTO_FIELD(std::vector<double>, values, {});
+};
+
+User<> make_user(uint32_t i) {
+  return {.id = i, .name = "user #" + std::to_string(i), .is_vip = i % 3 == 0, .score = i * 0.25};
+}
+
+Company<> make_company() {
+  Company<> company = {.name = "company"};
+  for (uint32_t d = 0; d < 4; ++d) {
+    Department<> department = {.name = "department #" + std::to_string(d), .head = make_user(d)};
+    for (uint32_t g = 0; g < 4; ++g) {
+      Group<> group = {.id = g};
+      for (uint32_t u = 0; u < 8; ++u) {
+        group.members.push_back(make_user(d * 100 + g * 10 + u));
+      }
+      department.groups.push_back(std::move(group));
+    }
+    company.departments.push_back(std::move(department));
+  }
+  return company;
+}
+
+Wide<> make_wide() {
+  return {.u0 = 1, .u1 = 1u << 20, .u2 = 1ull << 40, .u3 = 7, .i0 = -1, .i1 = 1 << 30, .i2 = -(1ll << 50), .i3 = 3,
+          .f0 = 0.5f, .f1 = 3.14159f, .d0 = 2.718281828, .d1 = -1e100, .b0 = true, .b1 = false, .s0 = "alpha",
+          .s1 = "beta gamma", .s2 = "", .s3 = "a somewhat longer string value", .u4 = 9, .u5 = 10, .d2 = 0.1,
+          .d3 = 1e-9, .tags = {1, 2, 3, 4, 5}, .s4 = "tail"};
+}
+
+Series<> make_series() {
+  Series<> series = {.name = "cpu"};
+  for (int64_t i = 0; i < 10000; ++i) {
+    series.stamps.push_back(1700000000000 + i * 1000);
+    series.values.push_back(i * 0.001 + 0.5);
+  }
+  return series;
+}
+
+template <typename Codec, typename Model>
+void bench_model(const char* codec_name, const char* shape, const Model& model) {
+  auto encoded = model.template encode_by<Codec>().value();
+  // about 32 MiB a case, a few hundred milliseconds
+  size_t iterations = std::clamp<size_t>((32 << 20) / encoded.size(), 20, 200000);
+  std::string label = std::string(codec_name) + " " + shape + " ";
+  mbench::measure((label + "encode").c_str(), iterations, [&]() {
+    auto res = model.template encode_by<Codec>();
+    mbench::do_not_optimize(res);
+  }, 1, encoded.size());
+  mbench::measure((label + "decode").c_str(), iterations, [&]() {
+    auto res = Model::template decode_by<Codec>(encoded);
+    mbench::do_not_optimize(res);
+  }, 1, encoded.size());
+  // the output buffer of a session is reused, so are the decoded model's strings and arrays
+  proto::CodecSession<Codec> session;
+  mbench::measure((label + "encode session").c_str(), iterations, [&]() {
+    auto res = model.encode_by(session);
+    mbench::do_not_optimize(res);
+  }, 1, encoded.size());
+  Model decoded;
+  mbench::measure((label + "decode into").c_str(), iterations, [&]() {
+    auto res = Model::decode_into(decoded, encoded, session);
+    mbench::do_not_optimize(res);
+  }, 1, encoded.size());
+  // a chunk a socket send
+  mbench::measure((label + "encode chunked").c_str(), iterations, [&]() {
+    auto res = model.template encode_chunked<Codec>(16 << 10, [](std::string_view chunk) {
+      mbench::do_not_optimize(chunk);
+      return true;
+    });
+    mbench::do_not_optimize(res);
+  }, 1, encoded.size());
+}
+
+template <typename Codec>
+void bench_codec(const char* codec_name) {
+  mbench::allocations = []() { return allocated.load(std::memory_order_relaxed); };
+  bench_model<Codec>(codec_name, "shallow", make_user(42));
+  bench_model<Codec>(codec_name, "deep", make_company());
+  bench_model<Codec>(codec_name, "wide", make_wide());
+  bench_model<Codec>(codec_name, "large array", make_series());
+}
+
+BENCH(proto, repr) { bench_codec<proto::ReprCodec>("repr"); }
+
+BENCH(proto, json) { bench_codec<proto::JsonCodec>("json"); }
+
+BENCH(proto, binary) { bench_codec<proto::BinaryCodec>("binary"); }
+
+template <typename From, typename To, typename Model>
+void bench_transcode(const char* shape, const Model& model) {
+  auto input = model.template encode_by<From>().value();
+  size_t iterations = std::clamp<size_t>((32 << 20) / input.size(), 20, 200000);
+  std::string label = std::string("json to binary ") + shape + " ";
+  mbench::measure((label + "decode and encode").c_str(), iterations, [&]() {
+    auto res = Model::template decode_by<From>(input)->template encode_by<To>();
+    mbench::do_not_optimize(res);
+  }, 1, input.size());
+  mbench::measure((label + "transcode").c_str(), iterations, [&]() {
+    auto res = proto::transcode<From, To, Model>(input);
+    mbench::do_not_optimize(res);
+  }, 1, input.size());
+}
+
+BENCH(proto, transcode) {
+  bench_transcode<proto::JsonCodec, proto::BinaryCodec>("shallow", make_user(42));
+  bench_transcode<proto::JsonCodec, proto::BinaryCodec>("deep", make_company());
+  bench_transcode<proto::JsonCodec, proto::BinaryCodec>("wide", make_wide());
+  bench_transcode<proto::JsonCodec, proto::BinaryCodec>("large array", make_series());
+}
+
+template <typename Model>
+void bench_incremental(const char* shape, const Model& model) {
+  auto input = model.template encode_by<proto::BinaryCodec>().value();
+  size_t iterations = std::clamp<size_t>((32 << 20) / input.size(), 20, 200000);
+  // a TCP segment a read
+  constexpr size_t chunk = 1460;
+  std::string label = std::string("binary ") + shape + " chunked ";
+  std::string buffer;
+  Model decoded;
+  mbench::measure((label + "buffer and decode").c_str(), iterations, [&]() {
+    buffer.clear();
+    for (size_t offset = 0; offset < input.size(); offset += chunk) {
+      buffer.append(std::string_view(input).substr(offset, chunk));
+    }
+    auto res = Model::template decode_into<proto::BinaryCodec>(decoded, buffer);
+    mbench::do_not_optimize(res);
+  }, 1, input.size());
+  proto::IncrementalDecoder<Model> decoder;
+  mbench::measure((label + "incremental").c_str(), iterations, [&]() {
+    decoder.reset();
+    for (size_t offset = 0; offset < input.size(); offset += chunk) {
+      decoder.feed(std::string_view(input).substr(offset, chunk));
+    }
+    mbench::do_not_optimize(decoder.model());
+  }, 1, input.size());
+}
+
+BENCH(proto, incremental) {
+  bench_incremental("shallow", make_user(42));
+  bench_incremental("deep", make_company());
+  bench_incremental("wide", make_wide());
+  bench_incremental("large array", make_series());
+}
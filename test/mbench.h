@@ -0,0 +1,246 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace mbench {
+
+class BaseBench {
+ public:
+  virtual void run() {}
+
+  virtual auto name() const -> const char* { return ""; }
+};
+
+template <typename T>
+inline void do_not_optimize(T&& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * @brief A measured case, as written by `--out`
+ */
+struct Result {
+  std::string label;
+  double ns = 0;  // per call
+  double ns_per_item = 0;
+  double mb_per_s = 0;      // 0 if no bytes are given
+  double allocations = -1;  // per call, -1 if not counted
+};
+
+// heap allocations made so far, set by a bench which counts them, e.g. in its `operator new`
+inline size_t (*allocations)() = nullptr;
+
+namespace _impl {
+
+inline std::vector<Result> results;
+
+}  // namespace _impl
+
+/**
+ * @brief Run `func` for `iterations` times after a short warm up, and print the average cost
+ *
+ * @param items Work items processed per call, e.g. fields or array elements, to print a per-item cost as well
+ * @param bytes Bytes processed per call, to print the throughput as well
+ * @return Average nanoseconds per call
+ */
+template <typename Func>
+double measure(const char* label, size_t iterations, Func&& func, size_t items = 1, size_t bytes = 0) {
+  for (size_t i = 0; i < iterations / 10 + 1; ++i) {
+    func();
+  }
+  size_t allocated = allocations ? allocations() : 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    func();
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+
+  Result result = {.label = label, .ns = ns, .ns_per_item = ns / items};
+  std::printf("    %-48s %12.1f ns/op %10.2f ns/item", label, ns, ns / items);
+  if (bytes > 0) {
+    result.mb_per_s = bytes / ns * 1e9 / (1 << 20);
+    std::printf(" %10.1f MB/s", result.mb_per_s);
+  }
+  if (allocations) {
+    result.allocations = double(allocations() - allocated) / iterations;
+    std::printf(" %8.2f allocs/op", result.allocations);
+  }
+  std::printf("\n");
+  _impl::results.push_back(std::move(result));
+  return ns;
+}
+
+namespace _impl {
+
+inline void save(const char* path) {
+  std::ofstream out(path);
+  out << "label\tns_per_op\tns_per_item\titems_per_s\tmb_per_s\tallocs_per_op\n";
+  for (auto& r : results) {
+    out << r.label << '\t' << r.ns << '\t' << r.ns_per_item << '\t' << 1e9 / r.ns_per_item << '\t' << r.mb_per_s
+        << '\t' << r.allocations << '\n';
+  }
+}
+
+// ns per call of each case written by `save()`, nothing if the file can not be read or has no case
+inline auto load(const char* path) -> std::optional<std::map<std::string, double>> {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "can not read results %s\n", path);
+    return std::nullopt;
+  }
+  std::map<std::string, double> ns;
+  std::string line;
+  for (std::getline(in, line); std::getline(in, line);) {
+    std::istringstream fields(line);
+    std::string label;
+    std::getline(fields, label, '\t');
+    fields >> ns[label];
+  }
+  if (ns.empty()) {
+    std::fprintf(stderr, "no results in %s\n", path);
+    return std::nullopt;
+  }
+  return ns;
+}
+
+// print the change of each case of `now` against `base`, and count the ones slower by more than `threshold` percent
+// and the ones run only once of the two, whose change is unknown
+inline size_t compare(const std::map<std::string, double>& base, const std::map<std::string, double>& now,
+                      double threshold) {
+  size_t regressions = 0;
+  size_t unmatched = 0;
+  std::printf(" *** compare, threshold %.1f%%\n", threshold);
+  for (auto& [label, ns] : now) {
+    auto it = base.find(label);
+    if (it == base.end()) {
+      ++unmatched;
+      std::printf("    %-48s %12s -> %12.1f ns/op  NEW\n", label.c_str(), "", ns);
+      continue;
+    }
+    double change = (ns / it->second - 1) * 100;
+    bool regressed = change > threshold;
+    regressions += regressed;
+    std::printf("    %-48s %12.1f -> %12.1f ns/op %+8.1f%%%s\n", label.c_str(), it->second, ns, change,
+                regressed ? "  REGRESSED" : "");
+  }
+  for (auto& [label, ns] : base) {
+    if (!now.contains(label)) {
+      ++unmatched;
+      std::printf("    %-48s %12.1f -> %12s ns/op  MISSING\n", label.c_str(), ns, "");
+    }
+  }
+  std::printf(" *** %zu regressions, %zu unmatched\n", regressions, unmatched);
+  return regressions + unmatched;
+}
+
+}  // namespace _impl
+
+/**
+ * @note Command line options:
+ *  - `--out FILE`: write the results as tab separated values
+ *  - `--compare FILE`: compare the results with the ones written by an earlier run, and fail on regressions or on
+ *    cases run only once of the two, the file must hold results
+ *  - `--diff OLD NEW`: compare two written results without running any bench
+ *  - `--threshold PERCENT`: slow down counted as a regression, 10 by default
+ */
+class Context {
+ public:
+  static int run(int argc = 0, char** argv = nullptr) {
+    const char* out = nullptr;
+    const char* base = nullptr;
+    const char* diff[2] = {};
+    double threshold = 10;
+    for (int i = 1; i < argc; ++i) {
+      if (!std::strcmp(argv[i], "--out") && i + 1 < argc) {
+        out = argv[++i];
+      } else if (!std::strcmp(argv[i], "--compare") && i + 1 < argc) {
+        base = argv[++i];
+      } else if (!std::strcmp(argv[i], "--threshold") && i + 1 < argc) {
+        threshold = std::atof(argv[++i]);
+      } else if (!std::strcmp(argv[i], "--diff") && i + 2 < argc) {
+        diff[0] = argv[++i];
+        diff[1] = argv[++i];
+      } else {
+        std::fprintf(stderr, "usage: %s [--out FILE] [--compare FILE] [--diff OLD NEW] [--threshold PERCENT]\n",
+                     argv[0]);
+        return 2;
+      }
+    }
+    if (diff[0]) {
+      auto old_ns = _impl::load(diff[0]);
+      auto new_ns = _impl::load(diff[1]);
+      if (!old_ns || !new_ns) {
+        return 2;
+      }
+      return _impl::compare(*old_ns, *new_ns, threshold) > 0;
+    }
+    // read before running, a wrong path fails at once
+    std::optional<std::map<std::string, double>> base_ns;
+    if (base && !(base_ns = _impl::load(base))) {
+      return 2;
+    }
+
+    for (size_t i = 0; i < Context::_benches.size(); ++i) {
+      auto& bench = *Context::_benches[i];
+      std::printf(" *** [%lu/%lu] [%s] bench begin\n", i, Context::_benches.size(), bench.name());
+      bench.run();
+      std::printf("\n");
+    }
+    if (out) {
+      _impl::save(out);
+    }
+    if (base) {
+      std::map<std::string, double> now;
+      for (auto& r : _impl::results) {
+        now[r.label] = r.ns;
+      }
+      return _impl::compare(*base_ns, now, threshold) > 0;
+    }
+    return 0;
+  }
+
+  template <typename T, typename... Args>
+    requires std::is_base_of_v<BaseBench, T>
+  constexpr static void regist(Args&&... args) {
+    Context::_benches.emplace_back(std::make_unique<T>(std::forward<Args>(args)...));
+  }
+
+ protected:
+  inline static std::vector<std::unique_ptr<BaseBench>> _benches = {};
+};
+
+}  // namespace mbench
+
+#define _STR(x) #x
+
+#define STR(x) _STR(x)
+
+#define BENCH_CLASS(bench_name, bench_suite_name) Bench__##bench_name##__##bench_suite_name
+
+#define BENCH(bench_name, bench_suite_name)                                                                \
+  class BENCH_CLASS(bench_name, bench_suite_name) {                                                        \
+   private:                                                                                                \
+    class Impl : public mbench::BaseBench {                                                                \
+     public:                                                                                               \
+      auto name() const -> const char* override { return STR(BENCH_CLASS(bench_name, bench_suite_name)); } \
+                                                                                                           \
+      void run() override;                                                                                 \
+    };                                                                                                     \
+                                                                                                           \
+    inline static auto _dumpy = (mbench::Context::regist<Impl>(), 0);                                      \
+  };                                                                                                       \
+                                                                                                           \
+  void BENCH_CLASS(bench_name, bench_suite_name)::Impl::run()
+
+int main(int argc, char** argv) { return mbench::Context::run(argc, argv); }
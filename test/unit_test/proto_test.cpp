@@ -1,10 +1,34 @@
 #include "proto.h"
 
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <new>
 #include <vector>
 
+#include "batch.h"
+#include "incremental.h"
 #include "mtest.h"
 #include "proto.h"
+#include "record.h"
+#include "transcode.h"
+#include "view.h"
+
+std::atomic<size_t> allocations = 0;
+
+void* operator new(size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
 
 template <typename C = proto::ReprCodec>
 struct UserDetail : public proto::BaseModel<UserDetail<C>> {
@@ -42,6 +66,9 @@ struct Message : public proto::BaseModel<Message<C>> {
   PROTO_FIELD(UserResponse<>, data, {});
 };
 
+static_assert(UserDetail<>::field_count() == 3 && User<>::field_count() == 3 && Message<>::field_count() == 3);
+static_assert(proto::_impl::FieldAt<User<>, 1>::name == "name" && proto::_impl::FieldAt<User<>, 2>::index == 2);
+
 // User<> user1 = {.id = 123, .name = "Alice", .detail = {.height = 1.6, .weight = 50.5, .address = "Beijing"}};
 // User<> user2 = {.id = 456, .name = "Bob", .detail = {.height = 1.8, .weight = 72.3, .address = "Shenzhen"}};
 // Message<> message = {.data = {user1, user2}};
@@ -122,6 +149,135 @@ TEST(proto, pretty_decode) {
   }
 }
 
+TEST(proto, json_structural_index) {
+  // the token starts by definition, one character a time
+  auto reference = [](std::string_view str) {
+    std::vector<uint32_t> tokens;
+    bool in_string = false, prev_scalar = false, escaped = false;
+    for (uint32_t i = 0; i < str.size(); ++i) {
+      char c = str[i];
+      bool quote = c == '"' && !escaped;
+      bool blank = c == ' ' || c == '\n' || c == '\t' || c == '\r';
+      bool op = std::string_view("{}[]:,").find(c) != std::string_view::npos;
+      bool scalar = !in_string && !quote && !blank && !op;
+      if ((!in_string && (op || quote)) || (scalar && !prev_scalar)) {
+        tokens.push_back(i);
+      }
+      in_string ^= quote;
+      prev_scalar = scalar;
+      escaped = c == '\\' && !escaped;
+    }
+    return tokens;
+  };
+  std::string_view alphabet = " \n\t\r\"\\\\{}[]:,a1-\x80\xff";
+  std::srand(42);
+  for (size_t size = 0; size < 300; ++size) {
+    std::string str;
+    for (size_t i = 0; i < size; ++i) {
+      str.push_back(alphabet[std::rand() % alphabet.size()]);
+    }
+    std::vector<uint32_t> tokens(size);
+    tokens.resize(proto::_impl::simd::json_tokens(str.data(), str.size(), tokens.data()));
+    ASSERT(tokens == reference(str), "size=%lu", size);
+  }
+
+  // long enough for several index windows
+  Message<> big;
+  std::string pretty = R"({ "code" : 1, "msg" : "", "data" : {
+  "user" : {"id": 0, "name": "unkown", "is_vip": false},
+  "followers" : [)";
+  for (uint32_t i = 0; i < 2000; ++i) {
+    big.data.followers.push_back({.id = i, .name = std::format("user {}", i)});
+    pretty += std::format("{}\n    {{\"id\" :  {},\t\"name\" : \"user {}\", \"is_vip\": false}}", i ? "," : "", i, i);
+  }
+  pretty += "\n  ]\n }\n}\n";
+  auto msg = Message<>::decode_by<proto::JsonCodec>(pretty);
+  ASSERT(msg && msg->data.followers.size() == 2000 && msg->data.followers[1999].name == "user 1999", "");
+  ASSERT(msg->data.encode_by<proto::JsonCodec>().value() == big.data.encode_by<proto::JsonCodec>().value(), "");
+
+  // the rest of a malformed number is not jumped over
+  ASSERT(!Message<>::decode_by<proto::JsonCodec>(R"({"code": 1x , "msg": "", "data": )"), "");
+}
+
+TEST(proto, json_key_order) {
+  static_assert(User<>::field_index("is_vip") == 2 && User<>::field_index("name", 1) == 1);
+  static_assert(User<>::field_index("id", 2) == 0 && User<>::field_index("unknown") == User<>::field_count());
+
+  auto json_str = R"({
+    "data": {
+      "followers": [{"name": "Bob", "id": 456, "tags": ["a", {"b": [1, 2]}]}, {"is_vip": true}],
+      "extra": null,
+      "user": {"is_vip": true, "name": "Alice", "id": 123}
+    },
+    "trace": {"id": "x,y", "spans": [[], {}]},
+    "code": 7
+  })";
+  auto msg = Message<>::decode_by<proto::JsonCodec>(json_str);
+  ASSERT(msg && msg->code == 7 && msg->msg.empty(), "");
+  ASSERT(msg->data.user.name == "Alice" && msg->data.user.id == 123 && msg->data.user.is_vip, "");
+  ASSERT(msg->data.followers.size() == 2 && msg->data.followers[0].id == 456 && !msg->data.followers[0].is_vip, "");
+  // missing keys keep the defaults
+  ASSERT(msg->data.followers[1].name == "unkown" && msg->data.followers[1].is_vip, "");
+
+  auto res = Message<>::decode_by<proto::JsonCodec>(R"({"data": {"user": {"extra": [1, }}})");
+  ASSERT(!res && res.error().path == "data.user.extra", "%s", res.error().what().c_str());
+  ASSERT(!Message<>::decode_by<proto::JsonCodec>(R"({"code": 1,})"), "");
+  ASSERT(!Message<>::decode_by<proto::JsonCodec>(R"({"extra": [1, 2)"), "");
+
+  // an unescaped key outlives the strings unescaped while its value is skipped
+  auto bad = std::format(R"({{"unknown_key_long\n_enough_for_heap": ["a\n{}", }})", std::string(200, 'z'));
+  res = Message<>::decode_by<proto::JsonCodec>(bad);
+  ASSERT(!res && res.error().path == "unknown_key_long\n_enough_for_heap", "%s", res.error().what().c_str());
+}
+
+TEST(proto, float_round_trip) {
+  UserDetail<> detail = {.height = 1.6f, .weight = 0.1, .address = ""};
+  ASSERT(detail.encode() == R"((1.6,0.1,""))", "%s", detail.encode()->c_str());
+
+  for (double weight : {72.3, 1.0 / 3, -2.2250738585072014e-308, 4.9e-324, 1.7976931348623157e308, 123456789.0}) {
+    detail.weight = weight;
+    detail.height = static_cast<float>(weight * 7);
+    auto check = [&detail]<typename Codec>() {
+      auto str = detail.encode_by<Codec>().value();
+      auto res = UserDetail<>::decode_by<Codec>(str);
+      ASSERT(res && res->weight == detail.weight && res->height == detail.height, "%s", str.c_str());
+      ASSERT(str.size() <= detail.encoded_size<Codec>(), "%s", str.c_str());
+    };
+    check.operator()<proto::ReprCodec>();
+    check.operator()<proto::JsonCodec>();
+  }
+}
+
+TEST(proto, string_escape) {
+  User<> user = {.id = 1};
+  for (std::string name : {"say \"hi\"", "back\\slash\\", "\b\f\n\r\t\x01\x1f", "utf-8 \xe4\xbd\xa0\xe5\xa5\xbd", ""}) {
+    // at each position of a string longer than a vector
+    for (size_t pad : {0, 17, 40}) {
+      user.name = std::string(pad, 'x') + name + std::string(pad, 'y');
+      auto json = user.encode_by<proto::JsonCodec>().value();
+      auto repr = user.encode().value();
+      ASSERT(json.size() == user.encoded_size<proto::JsonCodec>(), "%s", json.c_str());
+      ASSERT(repr.size() == user.encoded_size<proto::ReprCodec>(), "%s", repr.c_str());
+      ASSERT(User<>::decode_by<proto::JsonCodec>(json)->name == user.name && User<>::decode(repr)->name == user.name,
+             "%s", json.c_str());
+    }
+  }
+  ASSERT(User<>{.name = "a\"b\\c\nd\x02"}.encode() == R"((0,"a\"b\\c\nd\u0002",false))", "");
+
+  auto res = User<>::decode_by<proto::JsonCodec>(R"({"n\u0061me": "\u00e9\u4f60\ud83d\ude00\/", "id": 2})");
+  ASSERT(res && res->id == 2 && res->name == "\xc3\xa9\xe4\xbd\xa0\xf0\x9f\x98\x80/", "");
+  ASSERT(!User<>::decode_by<proto::JsonCodec>(R"({"name": "\x"})"), "");
+  ASSERT(!User<>::decode_by<proto::JsonCodec>(R"({"name": "\u12"})"), "");
+  // lone surrogates
+  for (auto name :
+       {R"("\ud800")", R"("\ud800x")", R"("\ud800\n")", R"("\ud800\ud800")", R"("\udc00")", R"("\udfff")"}) {
+    auto res = User<>::decode_by<proto::JsonCodec>(std::format(R"({{"name": {}}})", name));
+    ASSERT(!res && res.error().err_msg == "string parse: invalid unicode escape", "%s", name);
+  }
+  ASSERT(!User<>::decode_by<proto::JsonCodec>(R"({"name": "abc\)"), "");
+  ASSERT(!User<>::decode_by<proto::JsonCodec>(R"({"name": "abc\")"), "");
+}
+
 TEST(proto, binary_codec) {
   auto repr_str = message.encode();
   auto json_str = message.encode_by<proto::JsonCodec>();
@@ -140,4 +296,651 @@ TEST(proto, binary_codec) {
     auto msg = Message<>::decode_by<proto::BinaryCodec>(*bin_str);
     ASSERT(msg && msg->data.followers.size() == 2, "");
   }
-}
\ No newline at end of file
+}
+
+TEST(proto, output_sink) {
+  auto bin_str = message.encode_by<proto::BinaryCodec>();
+  auto json_str = message.encode_by<proto::JsonCodec>();
+  ASSERT(bin_str && json_str, "");
+
+  {
+    std::string out = "head";
+    auto n = message.encode_by<proto::JsonCodec>(out);
+    ASSERT(n && *n == json_str->size() && out == "head" + *json_str, "");
+  }
+  {
+    std::string buffer(bin_str->size(), '\0');
+    auto n = message.encode_by<proto::BinaryCodec>(std::span<char>(buffer));
+    ASSERT(n && *n == bin_str->size() && buffer == *bin_str, "");
+
+    auto small = message.encode_by<proto::BinaryCodec>(std::span<char>(buffer.data(), buffer.size() - 1));
+    ASSERT(!small, "");
+  }
+}
+
+TEST(proto, view_decode) {
+  auto repr_str = message.encode();
+  auto bin_str = message.encode_by<proto::BinaryCodec>();
+  ASSERT(repr_str && bin_str, "");
+
+  {
+    std::string stream = *bin_str + *bin_str;
+    std::string_view rest = stream;
+    for (int i = 0; i < 2; ++i) {
+      size_t consumed = 0;
+      auto msg = Message<>::decode_by<proto::BinaryCodec>(rest, consumed);
+      ASSERT(msg && consumed == bin_str->size() && msg->data.followers[1].name == "Cathy", "");
+      rest.remove_prefix(consumed);
+    }
+    ASSERT(rest.empty(), "");
+  }
+  {
+    std::string stream = *repr_str + "\n" + *repr_str;
+    size_t consumed = 0;
+    auto msg1 = Message<>::decode_by<proto::ReprCodec>(stream, consumed);
+    ASSERT(msg1 && consumed == repr_str->size(), "");
+    auto msg2 = Message<>::decode_by<proto::ReprCodec>(std::string_view(stream).substr(consumed), consumed);
+    ASSERT(msg2 && msg2->data.user.name == "Alice", "");
+  }
+  {
+    auto bytes = std::as_bytes(std::span(*bin_str));
+    auto msg = Message<>::decode_by<proto::BinaryCodec>(bytes);
+    ASSERT(msg && msg->data.user.is_vip, "");
+    ASSERT(!Message<>::decode_by<proto::BinaryCodec>(bytes.first(bytes.size() - 1)), "");
+  }
+}
+
+TEST(proto, error_path) {
+  {
+    auto repr_str = R"((0,"",((123,"Alice",true),[(456,"Bob",false),(789,Cathy,false)])))";
+    auto msg = Message<>::decode(repr_str);
+    ASSERT(!msg && msg.error().path == "data.followers[1].name", "path=%s", msg.error().path.c_str());
+  }
+  {
+    auto bin_str = message.encode_by<proto::BinaryCodec>().value();
+    auto msg = Message<>::decode_by<proto::BinaryCodec>(std::string_view(bin_str).substr(0, bin_str.size() - 1));
+    ASSERT(!msg && msg.error().path == "data.followers[1].is_vip", "path=%s", msg.error().path.c_str());
+  }
+}
+
+template <typename C = proto::BinaryCodec>
+struct Samples : public proto::BaseModel<Samples<C>> {
+  using Model = Samples;
+
+  PROTO_FIELD(std::vector<float>, values, {});
+  PROTO_FIELD(std::vector<uint16_t>, ids, {});
+  PROTO_FIELD(std::vector<int64_t>, stamps, {});
+};
+
+TEST(proto, binary_bulk_array) {
+  Samples<> samples;
+  for (int i = 0; i < 1000; ++i) {
+    samples.values.push_back(i * 0.25f);
+    samples.ids.push_back(i * 7);
+    samples.stamps.push_back(-i * 1000000007ll);
+  }
+  auto bin_str = samples.encode();
+  ASSERT(bin_str && bin_str->size() == 3 * 5 + 1000 * (4 + 2 + 8), "");
+  // big endian on the wire
+  ASSERT((*bin_str)[5 + 4 * 3] == 0x3f && (*bin_str)[5 + 4 * 3 + 1] == 0x40, "");
+
+  auto res = Samples<>::decode(*bin_str);
+  ASSERT(res && res->values == samples.values && res->ids == samples.ids && res->stamps == samples.stamps, "");
+  ASSERT(!Samples<>::decode(std::string_view(*bin_str).substr(0, bin_str->size() - 1)), "");
+}
+
+TEST(proto, little_endian_binary_codec) {
+  Samples<> samples = {.values = {0.75f, -2.5f}, .ids = {1, 2, 3}, .stamps = {-1}};
+  auto big = samples.encode_by<proto::BinaryCodec>();
+  auto little = samples.encode_by<proto::LittleEndianBinaryCodec>();
+  ASSERT(big && little && big->size() == little->size(), "");
+  // array length and the first float 0.75f = 0x3f400000
+  ASSERT(big->substr(1, 4) == std::string("\0\0\0\2", 4) && little->substr(1, 4) == std::string("\2\0\0\0", 4), "");
+  ASSERT(big->substr(5, 4) == std::string("\x3f\x40\0\0", 4) && little->substr(5, 4) == std::string("\0\0\x40\x3f", 4),
+         "");
+
+  auto res = Samples<>::decode_by<proto::LittleEndianBinaryCodec>(*little);
+  ASSERT(res && res->values == samples.values && res->ids == samples.ids && res->stamps == samples.stamps, "");
+
+  auto msg = Message<>::decode_by<proto::LittleEndianBinaryCodec>(*message.encode_by<proto::LittleEndianBinaryCodec>());
+  ASSERT(msg && msg->data.followers.size() == 2 && msg->data.followers[1].id == 789, "");
+}
+
+template <typename C = proto::BinaryCodec>
+struct Mixed : public proto::BaseModel<Mixed<C>> {
+  using Model = Mixed;
+
+  PROTO_FIELD(uint8_t, kind, 0);
+  PROTO_FIELD(double, score, 0);
+  PROTO_FIELD(std::string, label, "");
+  PROTO_FIELD(bool, active, false);
+  PROTO_FIELD(int16_t, delta, 0);
+  PROTO_FIELD(uint32_t, count, 0);
+  PROTO_FIELD(std::vector<uint16_t>, ids, {});
+  PROTO_FIELD(float, ratio, 0);
+};
+
+using MixedRuns = proto::_impl::ArithmeticRuns<Mixed<>>;
+static_assert(MixedRuns::lengths == std::array<size_t, 8>{2, 0, 0, 3, 0, 0, 0, 1});
+static_assert(MixedRuns::offsets[5] == 3 && MixedRuns::bytes[0] == 9 && MixedRuns::bytes[3] == 7);
+
+TEST(proto, fused_fields) {
+  Mixed<> mixed = {.kind = 7, .score = -0.5, .label = "x", .active = true, .delta = -2, .count = 0x01020304};
+  mixed.ratio = 1;
+  auto big = mixed.encode_by<proto::BinaryCodec>().value();
+  ASSERT(big.size() == mixed.encoded_size<proto::BinaryCodec>(), "");
+  // the fused run of `active`, `delta` and `count` is laid out as fields one by one
+  ASSERT(big.substr(15, 7) == std::string("\1\xff\xfe\1\2\3\4", 7), "");
+  auto res = Mixed<>::decode_by<proto::BinaryCodec>(big);
+  ASSERT(res && res->score == -0.5 && res->label == "x" && res->active && res->delta == -2, "");
+  ASSERT(res->count == 0x01020304 && res->ratio == 1, "");
+
+  auto little = Mixed<>::decode_by<proto::LittleEndianBinaryCodec>(*mixed.encode_by<proto::LittleEndianBinaryCodec>());
+  ASSERT(little && little->count == mixed.count && little->score == mixed.score, "");
+
+  // a short run fails at its field
+  res = Mixed<>::decode_by<proto::BinaryCodec>(std::string_view(big).substr(0, 20));
+  ASSERT(!res && res.error().path == "count", "path=%s", res.error().path.c_str());
+}
+
+template <typename C = proto::CompactBinaryCodec>
+struct Counters : public proto::BaseModel<Counters<C>> {
+  using Model = Counters;
+
+  PROTO_FIELD(int32_t, delta, 0);
+  PROTO_FIELD(uint64_t, total, 0);
+  PROTO_FIELD(uint16_t, small, 0);
+  PROTO_FIELD(std::vector<int64_t>, history, {});
+  PROTO_FIELD(std::vector<double>, ratios, {});
+  PROTO_FIELD(std::vector<bool>, flags, {});
+};
+
+template <typename C = proto::BinaryCodec>
+struct Empty : public proto::BaseModel<Empty<C>> {
+  using Model = Empty;
+};
+
+template <typename C = proto::BinaryCodec>
+struct Marks : public proto::BaseModel<Marks<C>> {
+  using Model = Marks;
+
+  PROTO_FIELD(std::vector<Empty<>>, marks, {});
+};
+
+TEST(proto, compact_binary_codec) {
+  auto bin_str = message.encode_by<proto::BinaryCodec>();
+  auto compact_str = message.encode_by<proto::CompactBinaryCodec>();
+  ASSERT(bin_str && compact_str && compact_str->size() < bin_str->size(), "");
+
+  auto msg = Message<>::decode_by<proto::CompactBinaryCodec>(*compact_str);
+  ASSERT(msg && msg->data.followers.size() == 2 && msg->data.followers[1].name == "Cathy", "");
+  ASSERT(msg->data.user.id == 123 && msg->data.user.is_vip, "");
+
+  Counters<> counters = {.delta = -1,
+                         .total = UINT64_MAX,
+                         .small = 300,
+                         .history = {0, -64, 64, INT64_MIN, INT64_MAX},
+                         .ratios = {0.5, -1e300}};
+  auto str = counters.encode();
+  // zigzag(-1) = 0x01, 10 bytes for UINT64_MAX, 300 = 0xac 0x02
+  ASSERT(str && str->substr(0, 1) == "\x01" && str->substr(11, 2) == "\xac\x02", "");
+
+  auto res = Counters<>::decode(*str);
+  ASSERT(res && res->delta == -1 && res->total == UINT64_MAX && res->small == 300, "");
+  ASSERT(res->history == counters.history && res->ratios == counters.ratios, "");
+
+  // 70000 does not fit `small`
+  std::string overflow = *str;
+  overflow.replace(11, 2, "\xf0\xa2\x04");
+  ASSERT(!Counters<>::decode(overflow), "");
+  // nor do the bits above the top one in the 10th byte of `total`
+  overflow = *str;
+  overflow[10] = 0x03;
+  ASSERT(!Counters<>::decode(overflow), "");
+
+  // empty models take no byte, an array of them is only its length
+  Marks<> marks = {.marks = std::vector<Empty<>>(3)};
+  auto check = [&marks]<typename Codec>() {
+    auto str = marks.encode_by<Codec>().value();
+    ASSERT(str.size() == marks.encoded_size<Codec>(), "");
+    auto res = Marks<>::decode_by<Codec>(str);
+    ASSERT(res && res->marks.size() == 3, "");
+  };
+  check.operator()<proto::BinaryCodec>();
+  check.operator()<proto::CompactBinaryCodec>();
+  auto out = proto::transcode<proto::BinaryCodec, proto::CompactBinaryCodec, Marks<>>(marks.encode().value());
+  ASSERT(out && *out == marks.encode_by<proto::CompactBinaryCodec>().value(), "");
+}
+
+TEST(proto, sized_binary_codec) {
+  auto str = message.encode_by<proto::SizedBinaryCodec>();
+  ASSERT(str, "");
+  auto msg = Message<>::decode_by<proto::SizedBinaryCodec>(*str);
+  ASSERT(msg && msg->encode().value() == message.encode().value(), "");
+
+  using proto::Path;
+  auto part = Message<>::decode_fields<proto::SizedBinaryCodec, Path<&Message<>::code>,
+                                       Path<&Message<>::data, &UserResponse<>::user, &User<>::id>,
+                                       Path<&Message<>::data, &UserResponse<>::followers, &User<>::name>>(*str);
+  ASSERT(part && part->data.user.id == 123 && part->data.user.name == "unkown" && !part->data.user.is_vip, "");
+  ASSERT(part->data.followers.size() == 2 && part->data.followers[1].name == "Cathy", "");
+  ASSERT(part->data.followers[1].id == 0, "");
+
+  // bytes are checked against the sizes of the skipped values
+  auto broken = str->substr(0, str->size() - 1);
+  part = Message<>::decode_fields<proto::SizedBinaryCodec, Path<&Message<>::code>>(broken);
+  ASSERT(!part, "");
+  auto full = Message<>::decode_by<proto::SizedBinaryCodec>(broken);
+  ASSERT(!full && full.error().path == "", "path=%s", full.error().path.c_str());
+}
+
+TEST(proto, table_binary_view) {
+  auto str = message.encode_by<proto::TableBinaryCodec>();
+  ASSERT(str && str->size() == message.encoded_size<proto::TableBinaryCodec>(), "");
+  auto msg = Message<>::decode_by<proto::TableBinaryCodec>(*str);
+  ASSERT(msg && msg->encode().value() == message.encode().value(), "");
+
+  auto view = proto::View<Message<>>::of(*str);
+  ASSERT(view && view->get<&Message<>::code>() == 0 && view->get<&Message<>::msg>() == "", "");
+  auto data = view->get<&Message<>::data>();
+  ASSERT(data.get<&UserResponse<>::user>().get<&User<>::is_vip>(), "");
+  auto followers = data.get<&UserResponse<>::followers>();
+  ASSERT(followers.size() == 2 && followers[1].get<&User<>::name>() == "Cathy", "");
+  uint32_t ids = 0;
+  for (auto follower : followers) {
+    ids += follower.get<&User<>::id>();
+  }
+  ASSERT(ids == 456 + 789 && followers[0].decode().value().name == "Bob", "");
+
+  Samples<> samples = {.values = {0.75f, -2.5f}, .ids = {1, 2, 3}};
+  auto samples_str = samples.encode_by<proto::TableBinaryCodec>().value();
+  auto ids_view = proto::View<Samples<>>::of(samples_str)->get<&Samples<>::ids>();
+  ASSERT(ids_view.size() == 3 && ids_view[2] == 3, "");
+
+  // a checked view never reads out of its bytes
+  for (size_t n = 0; n < str->size(); ++n) {
+    ASSERT(!proto::View<Message<>>::of(std::string_view(*str).substr(0, n)), "%lu", n);
+  }
+}
+
+TEST(proto, encoded_size) {
+  auto check = []<typename Codec>(const auto& model, bool exact) {
+    auto str = model.template encode_by<Codec>();
+    size_t size = model.template encoded_size<Codec>();
+    ASSERT(str && (exact ? str->size() == size : str->size() <= size), "size=%lu, expect=%lu", size, str->size());
+  };
+  Samples<> samples = {.values = {0.75f, -2.5f}, .ids = {1, 2, 3}, .stamps = {-1}};
+  Counters<> counters = {.delta = -100, .total = 1ull << 40, .history = {-64, 64, INT64_MIN}, .ratios = {0.5}};
+
+  check.operator()<proto::BinaryCodec>(message, true);
+  check.operator()<proto::BinaryCodec>(samples, true);
+  check.operator()<proto::LittleEndianBinaryCodec>(counters, true);
+  check.operator()<proto::CompactBinaryCodec>(message, true);
+  check.operator()<proto::CompactBinaryCodec>(counters, true);
+  check.operator()<proto::SizedBinaryCodec>(message, true);
+  check.operator()<proto::SizedBinaryCodec>(samples, true);
+  check.operator()<proto::TableBinaryCodec>(counters, true);
+  check.operator()<proto::ReprCodec>(message, true);
+  check.operator()<proto::JsonCodec>(message, true);
+  check.operator()<proto::JsonCodec>(counters, false);
+  check.operator()<proto::ReprCodec>(samples, false);
+}
+
+TEST(proto, bool_array) {
+  Counters<> counters = {.delta = 3, .history = {1}, .flags = {true, false, true, true}};
+  auto check = [&counters]<typename Codec>() {
+    auto str = counters.encode_by<Codec>().value();
+    ASSERT(str.size() <= counters.encoded_size<Codec>(), "");
+    Counters<> res = {.flags = {false, false, false, false, false, false}};
+    ASSERT(Counters<>::decode_into<Codec>(res, str) && res.flags == counters.flags && res.delta == 3, "");
+  };
+  check.operator()<proto::ReprCodec>();
+  check.operator()<proto::JsonCodec>();
+  check.operator()<proto::BinaryCodec>();
+  check.operator()<proto::LittleEndianBinaryCodec>();
+  check.operator()<proto::CompactBinaryCodec>();
+  check.operator()<proto::SizedBinaryCodec>();
+  check.operator()<proto::TableBinaryCodec>();
+}
+
+TEST(proto, decode_into) {
+  Message<> big = {.msg = "a message longer than the small string buffer"};
+  for (uint32_t i = 0; i < 100; ++i) {
+    big.data.followers.push_back({.id = i, .name = std::format("follower name longer than sso #{}", i)});
+  }
+  auto check = [&big]<typename Codec>() {
+    auto str = big.encode_by<Codec>().value();
+    Message<> msg;
+    ASSERT(Message<>::decode_into<Codec>(msg, str) == str.size(), "");
+    ASSERT(msg.data.followers.size() == 100 && msg.data.followers[99].name == big.data.followers[99].name, "");
+
+    size_t before = allocations;
+    for (int i = 0; i < 10; ++i) {
+      ASSERT(Message<>::decode_into<Codec>(msg, str), "");
+    }
+    ASSERT(allocations == before, "%lu allocations", allocations.load() - before);
+
+    // fewer elements
+    auto small = message.encode_by<Codec>().value();
+    ASSERT(Message<>::decode_into<Codec>(msg, small) && msg.data.followers.size() == 2, "");
+    ASSERT(msg.data.followers[1].name == "Cathy" && msg.msg.empty(), "");
+  };
+  check.operator()<proto::ReprCodec>();
+  check.operator()<proto::JsonCodec>();
+  check.operator()<proto::BinaryCodec>();
+  check.operator()<proto::CompactBinaryCodec>();
+
+  // nothing of the previous message is left by keys missing from the next one
+  User<> user;
+  ASSERT(User<>::decode_into<proto::JsonCodec>(user, R"({"id": 5, "name": "secret", "is_vip": true})"), "");
+  ASSERT(User<>::decode_into<proto::JsonCodec>(user, R"({"id": 6})"), "");
+  ASSERT(user.id == 6 && user.name == "unkown" && !user.is_vip, "");
+  Message<> msg = message;
+  ASSERT(Message<>::decode_into<proto::JsonCodec>(msg, R"({"code": 1})"), "");
+  ASSERT(msg.code == 1 && msg.data.followers.empty() && msg.data.user.name == "unkown", "");
+
+  auto res = User<>::decode_by<proto::JsonCodec>(R"({"id": 5, "name": "a", "id": 6})");
+  ASSERT(!res && res.error().what() == "id: duplicate key", "%s", res.error().what().c_str());
+}
+
+TEST(proto, transcode) {
+  Message<> big = {.code = 7, .msg = "tab\t and \"quotes\"", .data = {.user = user1, .followers = {user2, user3}}};
+  auto check = [&big]<typename From, typename To>() {
+    auto input = big.encode_by<From>().value();
+    auto out = proto::transcode<From, To, Message<>>(input);
+    ASSERT(out && *out == big.encode_by<To>().value(), "%s", out ? out->c_str() : out.error().what().c_str());
+  };
+  check.operator()<proto::ReprCodec, proto::BinaryCodec>();
+  check.operator()<proto::JsonCodec, proto::BinaryCodec>();
+  check.operator()<proto::JsonCodec, proto::CompactBinaryCodec>();
+  check.operator()<proto::BinaryCodec, proto::JsonCodec>();
+  check.operator()<proto::CompactBinaryCodec, proto::ReprCodec>();
+  check.operator()<proto::LittleEndianBinaryCodec, proto::BinaryCodec>();
+
+  // keys in another order, unknown and missing ones make their object decoded as a whole
+  auto json = R"({"data":{"followers":[{"name":"Bob","id":456,"x":1},{"id":789}]},"code":7})";
+  auto out = proto::transcode<proto::JsonCodec, proto::BinaryCodec, Message<>>(json);
+  auto expected = Message<>::decode_by<proto::JsonCodec>(json)->encode_by<proto::BinaryCodec>();
+  ASSERT(out && *out == *expected, "");
+
+  // a long array takes a longer compact length prefix, inserted once its elements are written
+  for (uint32_t i = 0; i < 200; ++i) {
+    big.data.followers.push_back({.id = i, .name = "follower"});
+  }
+  check.operator()<proto::JsonCodec, proto::CompactBinaryCodec>();
+
+  auto text = big.encode_by<proto::JsonCodec>().value();
+  std::string appended = "head";
+  appended.reserve(4096);
+  size_t before = allocations;
+  auto consumed = proto::transcode<proto::JsonCodec, proto::BinaryCodec, Message<>>(text, appended);
+  ASSERT(consumed == text.size() && allocations == before, "%lu allocations", allocations.load() - before);
+  ASSERT(appended == "head" + big.encode_by<proto::BinaryCodec>().value(), "");
+
+  auto bad = proto::transcode<proto::ReprCodec, proto::BinaryCodec, Message<>>(R"((0,"",((123,"Alice",true),[x])))");
+  ASSERT(!bad && bad.error().what().starts_with("data.followers[0]"), "%s", bad.error().what().c_str());
+}
+
+TEST(proto, incremental_decode) {
+  using Decoder = proto::IncrementalDecoder<Message<>>;
+  Message<> big = {.code = 7, .msg = "chunked", .data = {.user = user1, .followers = {user2, user3}}};
+  for (uint32_t i = 0; i < 100; ++i) {
+    big.data.followers.push_back({.id = i, .name = std::string(i % 7, 'x'), .is_vip = i % 2 == 0});
+  }
+  auto bytes = big.encode_by<proto::BinaryCodec>().value();
+  auto expected = big.encode_by<proto::ReprCodec>().value();
+
+  // byte by byte, numbers and lengths are split at every point
+  Decoder decoder;
+  for (size_t i = 0; i + 1 < bytes.size(); ++i) {
+    ASSERT(decoder.feed(std::string_view(bytes).substr(i, 1)) == Decoder::Status::need_more, "at %lu", i);
+  }
+  ASSERT(decoder.feed(std::string_view(bytes).substr(bytes.size() - 1)) == Decoder::Status::done, "");
+  ASSERT(decoder.consumed() == 1 && decoder.model().encode_by<proto::ReprCodec>() == expected, "");
+
+  // uneven chunks into the same model, with the next message following in the last chunk
+  std::string stream = bytes + message.encode_by<proto::BinaryCodec>().value();
+  decoder.reset();
+  auto status = Decoder::Status::need_more;
+  size_t offset = 0;
+  for (size_t size = 1; status == Decoder::Status::need_more; offset += size, size = size * 3 % 97 + 1) {
+    status = decoder.feed(std::string_view(stream).substr(offset, size));
+    ASSERT(status != Decoder::Status::done || offset + decoder.consumed() == bytes.size(), "");
+  }
+  ASSERT(status == Decoder::Status::done && decoder.model().encode_by<proto::ReprCodec>() == expected, "");
+
+  // arrays of numbers are copied as their bytes come, and swapped once complete
+  Samples<> samples = {.values = {0.75f, -2.5f}, .ids = {1, 2, 3}, .stamps = {-1, 1ll << 40}};
+  auto little = samples.encode_by<proto::LittleEndianBinaryCodec>().value();
+  using SampleDecoder = proto::IncrementalDecoder<Samples<>, proto::LittleEndianBinaryCodec>;
+  SampleDecoder sample_decoder;
+  ASSERT(sample_decoder.feed(std::string_view(little).substr(0, 11)) == SampleDecoder::Status::need_more, "");
+  ASSERT(sample_decoder.feed(std::string_view(little).substr(11)) == SampleDecoder::Status::done, "");
+  auto& res = sample_decoder.model();
+  ASSERT(res.values == samples.values && res.ids == samples.ids && res.stamps == samples.stamps, "");
+
+  // the path of a failure is told by the frames
+  auto bad = message.encode_by<proto::BinaryCodec>().value();
+  bad[bad.size() - 11] = 0;
+  decoder.reset();
+  ASSERT(decoder.feed(bad) == Decoder::Status::error, "");
+  ASSERT(decoder.error().path == "data.followers[1].name", "path=%s", decoder.error().path.c_str());
+}
+
+TEST(proto, encode_chunked) {
+  static_assert(proto::Chunkable<proto::BinaryCodec> && proto::Chunkable<proto::JsonCodec>);
+  static_assert(!proto::Chunkable<proto::SizedBinaryCodec> && !proto::Chunkable<proto::TableBinaryCodec>);
+  Message<> big = {.code = 7, .msg = std::string(100, 'm'), .data = {.user = user1, .followers = {user2, user3}}};
+  for (uint32_t i = 0; i < 100; ++i) {
+    big.data.followers.push_back({.id = i, .name = "follower \"" + std::to_string(i) + '"'});
+  }
+  auto check = [](const auto& model, auto codec, size_t chunk_size) {
+    using Codec = decltype(codec);
+    std::string joined;
+    size_t longest = 0;
+    auto n = model.template encode_chunked<Codec>(chunk_size, [&joined, &longest](std::string_view chunk) {
+      joined += chunk;
+      longest = std::max(longest, chunk.size());
+      return true;
+    });
+    auto expected = model.template encode_by<Codec>().value();
+    ASSERT(n == expected.size() && joined == expected, "%lu bytes in %lu bytes chunks", expected.size(), chunk_size);
+    ASSERT(longest <= chunk_size, "%lu bytes chunk", longest);
+  };
+  for (size_t chunk_size : {1, 7, 64, 4096}) {
+    check(big, proto::ReprCodec{}, chunk_size);
+    check(big, proto::JsonCodec{}, chunk_size);
+    check(big, proto::BinaryCodec{}, chunk_size);
+    check(big, proto::CompactBinaryCodec{}, chunk_size);
+  }
+  // arrays of numbers are copied a chunk at a time
+  Samples<> samples;
+  for (int i = 0; i < 1000; ++i) {
+    samples.values.push_back(i * 0.5f);
+    samples.stamps.push_back(-i);
+  }
+  check(samples, proto::BinaryCodec{}, 100);
+  check(samples, proto::LittleEndianBinaryCodec{}, 100);
+
+  // the flush stops the encoding
+  size_t flushed = 0;
+  auto stopped = big.encode_chunked<proto::JsonCodec>(64, [&flushed](std::string_view) { return ++flushed < 2; });
+  ASSERT(!stopped && stopped.error().err_msg == "output flush stopped" && flushed == 2, "");
+  // and the sink is back to its usual mode
+  auto json = big.encode_by<proto::JsonCodec>();
+  ASSERT(json && Message<>::decode_by<proto::JsonCodec>(*json)->data.followers.size() == 102, "");
+
+  // patches count from the first byte written, and may not reach a flushed one
+  std::string out;
+  auto collect = [&out](std::string_view chunk) {
+    out += chunk;
+    return true;
+  };
+  proto::Sink sink;
+  sink.flush_to(4, collect);
+  sink.write("abcdef");
+  sink.patch(5, "F", 1);
+  sink.insert(4, "-", 1);
+  sink.finish();
+  ASSERT(!sink.overflow() && out == "abcd-eF", "%s", out.c_str());
+  out.clear();
+  sink.flush_to(4, collect);
+  sink.write("abcdef");
+  sink.patch(1, "B", 1);
+  ASSERT(sink.overflow(), "");
+  sink.flush_to(4, collect);
+  sink.write("abcdef");
+  sink.insert(2, "-", 1);
+  ASSERT(sink.overflow(), "");
+  // an insert is not split across chunks
+  sink.flush_to(4, collect);
+  sink.write("abcdefgh");
+  sink.insert(4, "-", 1);
+  ASSERT(sink.overflow(), "");
+}
+
+TEST(proto, codec_session) {
+  // the bytes stay in the session buffer, which is reused by the next call
+  proto::CodecSession<proto::BinaryCodec> session;
+  auto bytes = message.encode_by(session);
+  ASSERT(bytes && *bytes == message.encode_by<proto::BinaryCodec>().value(), "");
+  size_t before = allocations;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT(message.encode_by(session), "");
+  }
+  ASSERT(allocations == before, "%lu allocations", allocations.load() - before);
+
+  // the token index of pretty printed json is kept by the thread's session between calls
+  std::string pretty = "{\n  \"code\": 7,\n  \"msg\": \"hi\"\n}";
+  Message<> msg;
+  ASSERT(Message<>::decode_into<proto::JsonCodec>(msg, pretty) && msg.code == 7, "");
+  before = allocations;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT(Message<>::decode_into<proto::JsonCodec>(msg, pretty), "");
+  }
+  ASSERT(allocations == before, "%lu allocations", allocations.load() - before);
+
+  // nor is more than a bound kept after an exceptionally large message, its unescaped strings included
+  Message<> huge = {.msg = std::string(2 << 20, '\n')};
+  auto huge_json = huge.encode_by<proto::JsonCodec>().value();
+  ASSERT(Message<>::decode_into<proto::JsonCodec>(msg, huge_json) && msg.msg == huge.msg, "");
+  {
+    proto::_impl::PooledSession<proto::JsonCodec> pooled;
+    ASSERT(pooled->codec().capacity() <= 1 << 20, "%lu bytes kept", pooled->codec().capacity());
+  }
+  ASSERT(Message<>::decode_into<proto::JsonCodec>(msg, pretty) && msg.code == 7, "");
+
+  // a nested call gets a session of its own
+  proto::_impl::PooledSession<proto::JsonCodec> outer;
+  proto::_impl::PooledSession<proto::JsonCodec> inner;
+  ASSERT(&*outer != &*inner, "");
+  ASSERT(Message<>::decode_by<proto::JsonCodec>(pretty), "");
+}
+
+template <typename C = proto::BinaryCodec>
+struct Feed : public proto::BaseModel<Feed<C>> {
+  using Model = Feed;
+
+  PROTO_FIELD(std::pmr::string, title, "");
+  PROTO_FIELD(std::pmr::vector<User<>>, users, {});
+  PROTO_FIELD(std::pmr::vector<std::pmr::string>, tags, {});
+  PROTO_FIELD(std::pmr::vector<uint32_t>, ids, {});
+};
+
+TEST(proto, pmr_decode) {
+  Feed<> feed = {.title = "a title longer than the small string buffer", .ids = {1, 2, 3}};
+  for (uint32_t i = 0; i < 10; ++i) {
+    feed.users.push_back({.id = i, .name = "user"});
+    feed.tags.emplace_back(std::format("a tag longer than the small string buffer #{}", i));
+  }
+  auto check = [&feed]<typename Codec>() {
+    auto str = feed.encode_by<Codec>().value();
+    alignas(std::max_align_t) char buffer[4096];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+    size_t before = allocations;
+    auto res = Feed<>::decode_by<Codec>(str, &arena);
+    ASSERT(allocations == before, "%lu allocations", allocations.load() - before);
+    ASSERT(res && res->title == feed.title && res->tags == feed.tags && res->ids == feed.ids, "");
+    ASSERT(res->users.size() == 10 && res->users[9].id == 9, "");
+    ASSERT(res->title.get_allocator().resource() == &arena && res->tags[0].get_allocator().resource() == &arena, "");
+  };
+  check.operator()<proto::BinaryCodec>();
+  check.operator()<proto::CompactBinaryCodec>();
+  check.operator()<proto::JsonCodec>();
+}
+
+TEST(proto, batch) {
+  std::vector<User<>> users;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    users.push_back({.id = i, .name = std::format("user {}", i), .is_vip = i % 3 == 0});
+  }
+  proto::ThreadPool pool(4);
+  auto check = [&users, &pool]<typename Codec>() {
+    auto serial = proto::encode_batch<Codec>(users);
+    auto parallel = proto::encode_batch<Codec>(std::span<const User<>>(users), &pool);
+    ASSERT(serial && parallel && serial->data == parallel->data && serial->offsets == parallel->offsets, "");
+    ASSERT(parallel->size() == 1000 && (*parallel)[7] == users[7].encode_by<Codec>().value(), "");
+
+    auto res = proto::decode_batch<Codec, User<>>(*parallel, &pool);
+    ASSERT(res && res->size() == 1000 && (*res)[999].name == "user 999" && (*res)[999].is_vip, "");
+
+    // the first failed model is reported
+    auto broken = *parallel;
+    broken.offsets.resize(502);
+    broken.data.resize(--broken.offsets.back());
+    res = proto::decode_batch<Codec, User<>>(broken, &pool);
+    ASSERT(!res && res.error().path.starts_with("[500]"), "%s", res.error().what().c_str());
+
+    // and so is a model which leaves bytes of its slice behind
+    std::vector<size_t> offsets = {0, parallel->offsets[1] + 1};
+    res = proto::decode_batch<Codec, User<>>(parallel->data, offsets);
+    ASSERT(!res && res.error().what() == "[0]: 1 trailing bytes", "%s", res.error().what().c_str());
+  };
+  check.operator()<proto::BinaryCodec>();
+  check.operator()<proto::JsonCodec>();
+  ASSERT(proto::encode_batch<proto::BinaryCodec>(std::vector<User<>>{}, &pool)->size() == 0, "");
+}
+
+TEST(proto, record_file) {
+  ASSERT(proto::_impl::simd::crc32c("123456789", 9) == 0xe3069283, "");
+  auto path = (std::filesystem::temp_directory_path() / "proto_test.rec").string();
+  for (bool index : {true, false}) {
+    auto writer = proto::RecordWriter::create(path, {.index = index});
+    ASSERT(writer, "%s", writer.error().what().c_str());
+    for (uint32_t i = 0; i < 100; ++i) {
+      ASSERT(writer->write(User<>{.id = i, .name = std::format("user {}", i)}), "");
+    }
+    ASSERT(writer->write_bytes("") && writer->close() && writer->size() == 101, "");
+
+    auto reader = proto::RecordReader::open(path);
+    ASSERT(reader && reader->size() == 101, "");
+    auto user = reader->read<User<>>(42);
+    ASSERT(user && user->id == 42 && user->name == "user 42", "");
+    ASSERT(reader->record(100) == "" && !reader->record(101), "");
+  }
+
+  // a record of a model followed by other bytes does not read back as the model
+  {
+    auto writer = proto::RecordWriter::create(path, {.checksum = false});
+    ASSERT(writer->write_bytes(User<>{.id = 1}.encode_by<proto::BinaryCodec>().value() + "xy") && writer->close(), "");
+    auto reader = proto::RecordReader::open(path);
+    auto user = reader->read<User<>>(0);
+    ASSERT(!user && user.error().what() == "record 0: 2 trailing bytes", "%s", user.error().what().c_str());
+  }
+
+
+  // a truncated tail is dropped by the frame walk, and a flipped byte fails its checksum
+  auto writer = proto::RecordWriter::create(path, {.index = false});
+  ASSERT(writer->write_bytes("first") && writer->write_bytes("second") && writer->close(), "");
+  std::string data(std::filesystem::file_size(path), '\0');
+  std::ifstream(path, std::ios::binary).read(data.data(), data.size());
+  auto truncated = proto::RecordReader::view(std::string_view(data).substr(0, data.size() - 1));
+  ASSERT(truncated && truncated->size() == 1 && truncated->record(0) == "first", "");
+  data[data.size() - 1] ^= 1;
+  auto corrupted = proto::RecordReader::view(data);
+  ASSERT(corrupted && corrupted->size() == 2 && corrupted->record(0) == "first", "");
+  ASSERT(!corrupted->record(1) && corrupted->record(1).error().what().ends_with("checksum mismatch"), "");
+  ASSERT(!proto::RecordReader::view("PROTOBUF"), "");
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,64 @@
+#include "proto.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+#include "mtest.h"
+
+template <typename C = proto::BinaryCodec>
+struct Point : public proto::BaseModel<Point<C>> {
+  using Model = Point;
+
+  PROTO_FIELD(int32_t, x, 0);
+  PROTO_FIELD(int32_t, y, 0);
+};
+
+template <typename C = proto::BinaryCodec>
+struct Shape : public proto::BaseModel<Shape<C>> {
+  using Model = Shape;
+
+  PROTO_FIELD(std::string, name, "");
+  PROTO_FIELD(std::vector<Point<>>, points, {});
+};
+
+// linked with the library copy which has the counters on, whatever the build flags are
+static_assert(proto::_impl::stats_enabled);
+
+auto find_stats(const std::vector<proto::ModelStats>& snapshot, std::string_view model) -> const proto::ModelStats* {
+  auto it = std::ranges::find_if(snapshot, [&](auto& s) { return s.model.starts_with(model); });
+  return it == snapshot.end() ? nullptr : &*it;
+}
+
+TEST(proto, stats) {
+  proto::stats_reset();
+  Shape<> shape = {.name = "square", .points = {{.x = 0, .y = 0}, {.x = 1, .y = 0}, {.x = 1, .y = 1}}};
+  auto bytes = shape.encode_by<proto::BinaryCodec>().value();
+  std::string appended;
+  ASSERT(shape.encode_by<proto::BinaryCodec>(appended), "");
+  ASSERT(Shape<>::decode_by<proto::BinaryCodec>(bytes), "");
+  ASSERT(!Shape<>::decode_by<proto::BinaryCodec>(bytes.substr(0, 5)), "");
+
+  auto snapshot = proto::stats_snapshot();
+  auto* stats = find_stats(snapshot, "Shape<");
+  ASSERT(stats, "");
+  ASSERT(stats->encode.calls == 2 && stats->encode.failures == 0 && stats->encode.bytes == bytes.size() * 2, "");
+  ASSERT(stats->decode.calls == 2 && stats->decode.failures == 1 && stats->decode.bytes == bytes.size(), "");
+  // the first of every `sample_every` calls is timed
+  ASSERT(stats->encode.timed == 1, "");
+  ASSERT(std::accumulate(stats->encode.histogram.begin(), stats->encode.histogram.end(), uint64_t(0)) == 1, "");
+
+  // each thread counts on its own shard, a snapshot sums them
+  std::thread([&]() { ASSERT(shape.encode_by<proto::BinaryCodec>(), ""); }).join();
+  std::thread([&]() { ASSERT(shape.encode_by<proto::BinaryCodec>(), ""); }).join();
+  snapshot = proto::stats_snapshot();
+  stats = find_stats(snapshot, "Shape<");
+  ASSERT(stats->encode.calls == 4 && stats->encode.bytes == bytes.size() * 4, "");
+  // nested models are counted as part of the outer one
+  ASSERT(!find_stats(snapshot, "Point<"), "");
+
+  proto::stats_reset();
+  snapshot = proto::stats_snapshot();
+  stats = find_stats(snapshot, "Shape<");
+  ASSERT(stats && stats->encode.calls == 0 && stats->decode.bytes == 0, "");
+}